@@ -13,10 +13,35 @@ Flags can be set in the "Define Block" below.
 When "AVX" is defined, AVX will be used in doing "+", "-", and AVX2 will be used in doing, "*", "%".
 When "AVX" is not defined and "SSE" is defined, SSE2 will be used in doing "+", "-", and SSE4.1 will be used in doing, "*", "%".
 When neither of the flag is defined, nothing will be used to speed up.
+Compiling with -DBIGINT_NO_AVX or -DBIGINT_NO_SSE turns the flags off without editing this file.
+When "COW" is defined, copies of a Bigint share their digits until one of them is changed,
+so handing the same big number to many places costs nothing. It is off by default.
+
+***** TUNING *****
+How often "*" sweeps its carries, and from how many digits on SIMD beats plain loops,
+depend on the CPU. bigint-tune.cpp measures them on the current machine:
+	g++ -O2 -mavx2 bigint-tune.cpp -o bigint-tune && ./bigint-tune
+It writes bigint_tuning.h next to bigint.h, which is picked up when found.
+The values can also be changed at startup through Bigint::tuning():
+	Bigint::tuning().mulSimdMinDigits = 24;
+
+***** BENCHMARK *****
+bigint-bench.cpp times every operation from 10 to 10^7 digits, with and without SIMD,
+and prints ns/op, digits/s and allocations/op as JSON. See the top of that file for
+how to build it for each instruction set and how to compare against GMP.
+
+***** STATISTICS *****
+When "STATS" is defined, Bigint counts calls, digits processed and nanoseconds spent in
+every kernel ("+", "-", both "*" paths, carry sweeps of "*", "%", load, extract),
+plus digit buffer allocations. Without the flag the counting compiles to nothing.
+	BigintStats s = Bigint::statistics();    // snapshot, safe to call from any thread
+	printf("%llu\n", s.carrySweep.calls);
+	Bigint::resetStatistics();
 
 ***** ANOTHER WARNING *****
 bigint.h uses C++11 feature. (right value reference)
 It may cause compile error when compiling on compilers which don't support C++11.
+FixedBigint (Part 5) needs C++14 (constexpr loops) and is left out on older compilers.
 
 
 ***** USAGE *****
@@ -53,26 +78,463 @@ Part 3: little tricks
 		It's much faster than using "a % two == one".
 	isZero:
 		If the number is zero, return true, otherwise false.
+	small:
+		Bigint::small(-42) builds a Bigint from a long long without going through a string.
+	constant, powerOfTwo, powerOfTen:
+		Bigint::constant(2), Bigint::powerOfTwo(100) and Bigint::powerOfTen(100) return
+		shared, ready-made numbers. They cover -16..256 and exponents 0..256.
+		They are const, so use them on the right side of an operator:
+			a = a * Bigint::constant(2);
+	compare:
+		a.compare(b) returns -1, 0 or 1 as a is smaller than, equal to or greater than b.
+		"==", "<" and compare are const and look at the sign.
+	hash:
+		a.hash() hashes the digits and the sign; the value is cached until a changes.
+		std::hash<Bigint> uses it, so Bigint works as a key of std::unordered_map.
+	reserve, shrinkToFit, getCapacity:
+		a.reserve(100000) makes room for 100000 digits up front, a.shrinkToFit() gives
+		back what the current value does not need, and a.getCapacity() tells how many
+		digits fit without reallocating. When load or "=" have to grow a number on their
+		own, they at least double its room, so growing step by step stays cheap.
+
+Part 4: batches
+	BigintBatch holds many numbers of the same width (in digits) and works on
+	all of them at once, one number per SIMD lane. Use it when there are lots of
+	small numbers; a single big number is still faster in Bigint.
+		BigintBatch a(1000, 80), b(1000, 80), sum(1000, 81), prod(1000, 160);
+		a.set(0, x); b.set(0, y);        // x, y are Bigint
+		sum.add(a, b);                   // sum[i] = a[i] + b[i] for every i
+		sum.subtract(a, b);
+		prod.multiply(a, b);
+		int order[1000];
+		a.compare(b, order);             // order[i] is -1, 0 or 1
+		Bigint z = sum.get(0);
+	The result batch must be wide enough (a.width + 1 for "+" and "-",
+	a.width + b.width for "*"), otherwise the high digits are lost.
+	All batches in one operation must hold the same count of numbers.
+
+Part 5: fixed width
+	FixedBigint<Bits> is an unsigned integer of exactly Bits bits kept on the
+	stack, for widths known at compile time (128, 256, ..., 4096).
+	"+", "-", "*" wrap around modulo 2^Bits like unsigned int does,
+	and everything is constexpr, so constants can be computed while compiling:
+		constexpr FixedBigint<256> p = FixedBigint<256>::fromString("115792089237316195423570985008687907853269984665640564039457584007908834671663");
+		constexpr FixedBigint<256> q = p * p + FixedBigint<256>(7);
+	Converting from and to Bigint:
+		FixedBigint<256> f(example);     // negative numbers wrap around
+		Bigint back = f.toBigint();
+
+Part 6: residue number system
+	BigintRNS keeps a number as its remainders modulo a set of primes just
+	below 2^31. "+", "-", "*" then work on every prime separately with no carries,
+	which pays off for long chains of multiplications.
+	Give the number of decimal digits the results may grow to when converting:
+		BigintRNS x(example, 2000), y(other, 2000);
+		BigintRNS z = x * y * y - x;
+		Bigint result = z.toBigint();    // exact if |result| < 10^2000
+	Both sides of an operator must be built with the same digit count, otherwise
+	it throws std::invalid_argument.
+	Up to 65536 primes (about 590000 digits) are available; asking for more
+	throws std::length_error.
+
+Part 7: products
+	Multiplying many numbers one after another keeps multiplying one huge number
+	by one tiny number. These helpers pair the factors up in a balanced tree instead:
+		Bigint p = Bigint::product(numbers, numbers + count);
+		Bigint f = Bigint::factorial(100000);
+		Bigint c = Bigint::binomial(100000, 30000);
+	Pass true as the last argument to multiply the two halves of the tree on
+	separate threads:
+		Bigint f = Bigint::factorial(100000, true);
+
+Part 8: other radixes
+	toString and fromString write and read any radix from 2 to 36, using the digits
+	0-9 and a-z (fromString also takes A-Z), with a leading '-' for negative numbers:
+		std::string hex = example.toString(16);
+		Bigint back = Bigint::fromString(hex.c_str(), 16);
+	Other radixes throw std::invalid_argument.
+	The number is split in halves against cached powers of the radix, but the halves
+	are still joined with schoolbook products, so the time grows quadratically with
+	the length, as for "*". Radixes 2, 4, 8, 16 and 32 are cut
+	straight out of the binary words; toString(10) and fromString(s, 10) are the
+	same as extract and load.
+
+Part 9: floating point
+	BigFloat is mantissa * 10^exponent with a Bigint mantissa of at most precision
+	decimal digits. "+", "-", "*", "/" and sqrt are correctly rounded (to nearest,
+	ties to even) to the larger precision of the operands:
+		BigFloat two = BigFloat::fromString("2", 10000);
+		BigFloat root = two.sqrt();
+		BigFloat third = BigFloat::fromString("1", 10000) / BigFloat::fromString("3", 10000);
+		std::string text = root.toString();    // "1.4142...e+0"
+	"/" and sqrt run Newton iterations that double the working precision on every
+	step and round their operands to it before multiplying, then fix the last digit
+	with one exact check. Dividing by zero and sqrt of a negative number give zero.
+
+Part 10: background operations
+	multiplyAsync, moduloAsync, productAsync and factorialAsync queue the work on a
+	pool of worker threads and return a std::future at once. The operands are copied,
+	so they may go away before the result is ready. A BigintJob lets the caller
+	follow and stop the operation:
+		std::shared_ptr<BigintJob> job = std::make_shared<BigintJob>([](double done) {
+			printf("%.1f%%\n", done * 100);    // called on the worker thread
+		});
+		std::future<Bigint> f = Bigint::multiplyAsync(a, b, job);
+		job->cancel();                         // from any thread
+		Bigint c = f.get();                    // throws BigintCancelled if it was stopped
+	The work checks for cancellation at every carry sweep of "*", every step of "%"
+	and every node of the product tree. Progress is the share of rows done for "*",
+	of subtractions done for "%", and of multiplications done for productAsync;
+	factorialAsync only reports when it is finished.
+	BigintExecutor::shared() has one thread per core; give another BigintExecutor
+	as the last argument to keep big jobs apart from others. Destroying an executor
+	(the shared one at exit) cancels the operations still waiting in it and waits
+	for the running ones.
 */
 
 // ***** Define Block Start *****
 #define AVX
 #define SSE
+// #define COW
+// #define STATS
 // ***** Define Block End *****
 
+#if defined BIGINT_NO_AVX
+#undef AVX
+#endif
+#if defined BIGINT_NO_SSE
+#undef SSE
+#endif
+
+// called with the byte count of every digit buffer Bigint allocates
+#ifndef BIGINT_ON_ALLOCATE
+#define BIGINT_ON_ALLOCATE(bytes)
+#endif
+
+#if defined __has_include
+#if __has_include("bigint_tuning.h")
+#include "bigint_tuning.h"
+#endif
+#endif
+#ifndef BIGINT_CARRY_SWEEP
+#define BIGINT_CARRY_SWEEP 1000000
+#endif
+#ifndef BIGINT_ADD_SIMD_MIN_DIGITS
+#define BIGINT_ADD_SIMD_MIN_DIGITS 0
+#endif
+#ifndef BIGINT_MUL_SIMD_MIN_DIGITS
+#define BIGINT_MUL_SIMD_MIN_DIGITS 0
+#endif
+
 #include <cstring>
 #include <iostream>
 #include <cstdio>
 #include <stack>
 #include <immintrin.h>
 #include <emmintrin.h>
+#include <mm_malloc.h>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+class BigintBatch;
+template <int Bits> class FixedBigint;
+
+struct BigintStats
+{
+	struct Counter
+	{
+		unsigned long long calls;
+		unsigned long long limbs;
+		unsigned long long nanoseconds;
+	};
+	Counter add, subtract, multiplySimd, multiplyPlain, carrySweep, modulo, load, extract;
+	unsigned long long allocations;
+	unsigned long long allocatedBytes;
+};
+
+#if defined STATS
+enum __bigint_stat_id
+{
+	__STAT_ADD, __STAT_SUBTRACT, __STAT_MULTIPLY_SIMD, __STAT_MULTIPLY_PLAIN,
+	__STAT_CARRY_SWEEP, __STAT_MODULO, __STAT_LOAD, __STAT_EXTRACT, __STAT_COUNT
+};
+
+struct __bigint_stat_counter
+{
+	std::atomic<unsigned long long> calls, limbs, nanoseconds;
+};
+
+struct __bigint_stat_table
+{
+	__bigint_stat_counter counter[__STAT_COUNT];
+	std::atomic<unsigned long long> allocations, allocatedBytes;
+};
+
+// zero-initialized because it is static
+inline __bigint_stat_table & __bigint_stats()
+{
+	static __bigint_stat_table table;
+	return table;
+}
+
+// counts one call on construction and adds the time spent on destruction
+class __bigint_stat_scope
+{
+	__bigint_stat_counter &counter;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	__bigint_stat_scope(int id, long long limbs) : counter(__bigint_stats().counter[id]), start(std::chrono::steady_clock::now())
+	{
+		++counter.calls;
+		counter.limbs += limbs;
+	}
+	~__bigint_stat_scope()
+	{
+		counter.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+
+#define BIGINT_STAT_SCOPE(id, limbs) __bigint_stat_scope __stat_scope(id, limbs)
+#define BIGINT_STAT_ALLOCATE(bytes) (++__bigint_stats().allocations, __bigint_stats().allocatedBytes += (bytes))
+#else
+#define BIGINT_STAT_SCOPE(id, limbs)
+#define BIGINT_STAT_ALLOCATE(bytes)
+#endif
+
+class BigintCancelled : public std::exception
+{
+public:
+	const char * what() const noexcept
+	{
+		return "Bigint operation cancelled";
+	}
+};
+
+// shared by the caller and the worker running one background operation
+class BigintJob
+{
+	std::atomic<bool> cancelled;
+	std::atomic<double> progress;
+	std::atomic<long long> stepsDone;
+	long long stepsTotal;
+	std::atomic<double> lastReported;
+	std::function<void(double)> onProgress;
+
+public:
+	explicit BigintJob(std::function<void(double)> onProgress_ = std::function<void(double)>())
+		: cancelled(false), progress(0), stepsDone(0), stepsTotal(0), lastReported(0), onProgress(onProgress_)
+	{
+	}
+	void cancel()
+	{
+		cancelled = true;
+	}
+	bool isCancelled() const
+	{
+		return cancelled;
+	}
+	double getProgress() const
+	{
+		return progress;
+	}
+	// the callback only sees steps of at least 0.1%, and always sees the end;
+	// with a parallel product, only one thread wins each report
+	void __report(double fraction)
+	{
+		progress = fraction;
+		double last = lastReported;
+		if (onProgress && (fraction - last >= 0.001 || fraction == 1) && lastReported.compare_exchange_strong(last, fraction))
+			onProgress(fraction);
+	}
+	void __begin(long long steps)
+	{
+		stepsDone = 0;
+		stepsTotal = steps;
+	}
+	void __step()
+	{
+		long long done = ++stepsDone;
+		if (stepsTotal > 0 && done < stepsTotal)
+			__report(double(done) / stepsTotal);
+	}
+};
+
+// the job of the operation running on this thread, if any; quiet jobs count
+// their own steps instead of taking the progress of single kernels
+struct __bigint_job_slot
+{
+	BigintJob *job;
+	bool quiet;
+};
+
+inline __bigint_job_slot & __bigint_current_job()
+{
+	static thread_local __bigint_job_slot slot = { NULL, false };
+	return slot;
+}
+
+// called at block boundaries of long loops: throws if the job was cancelled
+inline void __bigint_checkpoint(long long done, long long total)
+{
+	__bigint_job_slot &slot = __bigint_current_job();
+	if (slot.job == NULL)
+		return;
+	if (slot.job->isCancelled())
+		throw BigintCancelled();
+	if (!slot.quiet && total > 0)
+		slot.job->__report(double(done) / total);
+}
+
+inline void __bigint_step()
+{
+	__bigint_job_slot &slot = __bigint_current_job();
+	if (slot.job != NULL)
+		slot.job->__step();
+}
+
+// a fixed set of worker threads taking queued operations in order
+class BigintExecutor
+{
+	std::mutex lock;
+	std::condition_variable wake;
+	// the job is kept next to its task so that a stopping executor can cancel it
+	struct __queued
+	{
+		std::shared_ptr<BigintJob> job;
+		std::function<void()> run;
+	};
+	std::deque<__queued> queue;
+	std::vector<std::thread> workers;
+	bool stopping;
+	void __work()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [this] { return stopping || !queue.empty(); });
+				if (queue.empty())
+					return;
+				task = queue.front().run;
+				queue.pop_front();
+			}
+			task();
+		}
+	}
+
+public:
+	explicit BigintExecutor(int threads) : stopping(false)
+	{
+		for (int i = 0; i < threads; ++i)
+			workers.push_back(std::thread(&BigintExecutor::__work, this));
+	}
+	BigintExecutor(const BigintExecutor &x) = delete;
+	BigintExecutor& operator=(const BigintExecutor &x) = delete;
+	// cancels what is still queued (those futures throw BigintCancelled),
+	// waits for the operations already running, then stops
+	~BigintExecutor()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+			for (size_t i = 0; i < queue.size(); ++i)
+				queue[i].job->cancel();
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < workers.size(); ++i)
+			workers[i].join();
+	}
+	static BigintExecutor & shared();
+	// steps > 0: the task calls __bigint_step that many times; steps < 0: no progress
+	// until done; steps == 0: progress comes from the kernels
+	template <class Task>
+	std::future<class Bigint> submit(std::shared_ptr<BigintJob> job, Task task, long long steps);
+};
 
 class Bigint
 {
+	friend class BigintBatch;
+	template <int Bits> friend class FixedBigint;
+	friend class BigintRNS;
+	friend class BigFloat;
+	// rows are 64-byte aligned and their capacity is a multiple of 16 ints,
+	// so SIMD loops can run over whole vectors; digits in [size, capacity) stay 0.
+	// One cache line in front of every row holds the count of its owners.
+	static const int __ROW_ALIGN = 64;
+	static const int __ROW_PAD = 16;
 	int size;
 	int capacity;
 	bool isNegative;
 	int *row;
+	// 0 until hash() computes it, reset by everything that changes the value
+	mutable std::atomic<size_t> hashValue;
+	static int * __allocate_row(int &cap)
+	{
+		cap = (cap + __ROW_PAD - 1) / __ROW_PAD * __ROW_PAD;
+		BIGINT_ON_ALLOCATE(sizeof(int) * (cap + __ROW_PAD));
+		BIGINT_STAT_ALLOCATE(sizeof(int) * (cap + __ROW_PAD));
+		int *block = static_cast<int*>(_mm_malloc(sizeof(int) * (cap + __ROW_PAD), __ROW_ALIGN));
+		new (block) std::atomic<int>(1);
+		return block + __ROW_PAD;
+	}
+	static std::atomic<int> & __row_owners(int *ptr)
+	{
+		return *reinterpret_cast<std::atomic<int>*>(ptr - __ROW_PAD);
+	}
+	static int * __share_row(int *ptr)
+	{
+		++__row_owners(ptr);
+		return ptr;
+	}
+	static void __free_row(int *ptr)
+	{
+		if (--__row_owners(ptr) == 0)
+			_mm_free(ptr - __ROW_PAD);
+	}
+	// must be called before writing into a row that may be shared
+	void __detach()
+	{
+		if (__row_owners(row).load() == 1)
+			return;
+		int cap = capacity;
+		int *fresh = __allocate_row(cap);
+		memcpy(fresh, row, sizeof(int) * size);
+		memset(fresh + size, 0, sizeof(int) * (cap - size));
+		__free_row(row);
+		row = fresh;
+		capacity = cap;
+	}
+	void __assign_digits(const Bigint &x);
+	int __highest_difference(const Bigint &x) const;
+	// makes row a private buffer of at least needed ints, growing geometrically;
+	// if it has to reallocate, the old digits are dropped and size becomes 0
+	void __prepare_row(int needed)
+	{
+		if (capacity >= needed && __row_owners(row).load() == 1)
+			return;
+		int grown = capacity * 2 > needed ? capacity * 2 : needed;
+		__free_row(row);
+		capacity = capacity >= needed ? capacity : grown;
+		row = __allocate_row(capacity);
+		memset(row, 0, sizeof(int) * capacity);
+		size = 0;
+	}
+	void __reallocate_row(int needed);
 	void __eliminate_double_zero()
 	{
 		if (size == 1)
@@ -83,54 +545,100 @@ class Bigint
 	Bigint __plain_add(const Bigint &a, const Bigint &b);
 	Bigint __plain_subtract(const Bigint &a, const Bigint &b);
 	Bigint __plain_multiply(const Bigint &a, const Bigint &b);
-	Bigint(int iniCapacity) : size(1), capacity(iniCapacity), isNegative(false)
+	Bigint(int iniCapacity) : size(1), capacity(iniCapacity), isNegative(false), hashValue(0)
 	{
-		row = new int[iniCapacity];
-		memset(row, 0, sizeof(int) * iniCapacity);
-		row[0] = 0;
+		row = __allocate_row(capacity);
+		memset(row, 0, sizeof(int) * capacity);
 	}
+	static Bigint __from_unsigned(unsigned long long x);
+	static Bigint __product_tree(const Bigint *first, const Bigint *last, int parallelDepth);
+	static Bigint __product_of_factors(std::vector<unsigned long long> &factors, bool parallel);
+	static std::vector<int> __primes_up_to(int n);
+	static Bigint __swing(int n, const std::vector<int> &primes, bool parallel);
+	static Bigint __factorial(int n, const std::vector<int> &primes, bool parallel);
+	struct __constant_table;
+	static const __constant_table & __constants();
+	struct __radix_table;
+	static __radix_table & __radix_tables(int radix);
+	static void __limb_multiply(const std::vector<unsigned int> &a, const std::vector<unsigned int> &b,
+		std::vector<unsigned int> &result, unsigned long long base);
+	void __digits_to_limbs(int low, int count, const std::vector<std::vector<unsigned int> > &tens,
+		unsigned long long base, std::vector<unsigned int> &result) const;
+	static Bigint __limbs_to_digits(const unsigned int *limbs, int count, const std::vector<Bigint> &powers);
 
 public:
-	Bigint() : size(1), capacity(32), isNegative(false)
+	struct Tuning
+	{
+		// products added in "*" between two carry sweeps, at most 26000000
+		int carrySweep;
+		// "+" and "-" use SIMD when the shorter number has at least this many digits
+		int addSimdMinDigits;
+		// "*" uses SIMD when the longer number has at least this many digits
+		int mulSimdMinDigits;
+	};
+	static Tuning & tuning()
 	{
-		row = new int[32];
-		memset(row, 0, sizeof(int) * 32);
-		row[0] = 0;
+		static Tuning settings = { BIGINT_CARRY_SWEEP, BIGINT_ADD_SIMD_MIN_DIGITS, BIGINT_MUL_SIMD_MIN_DIGITS };
+		return settings;
 	}
-	Bigint(const Bigint &x)
+	Bigint() : size(1), capacity(__ROW_PAD), isNegative(false), hashValue(0)
 	{
-		row = new int[x.capacity];
-		memcpy(row, x.row, sizeof(int) * x.capacity);
-		size = x.size;
+		row = __allocate_row(capacity);
+		memset(row, 0, sizeof(int) * capacity);
+	}
+	Bigint(const Bigint &x) : hashValue(x.hashValue.load(std::memory_order_relaxed))
+	{
+#if defined COW
 		capacity = x.capacity;
+		row = __share_row(x.row);
+#else
+		capacity = x.size + 1;
+		row = __allocate_row(capacity);
+		memcpy(row, x.row, sizeof(int) * x.size);
+		memset(row + x.size, 0, sizeof(int) * (capacity - x.size));
+#endif
+		size = x.size;
 		isNegative = x.isNegative;
 	}
-	Bigint(Bigint &&x)
+	Bigint(Bigint &&x) : hashValue(x.hashValue.load(std::memory_order_relaxed))
 	{
+		x.hashValue.store(0, std::memory_order_relaxed);
 		row = x.row;
-		x.row = new int[1];
 		size = x.size;
 		capacity = x.capacity;
 		isNegative = x.isNegative;
+		x.capacity = __ROW_PAD;
+		x.row = __allocate_row(x.capacity);
+		memset(x.row, 0, sizeof(int) * x.capacity);
+		x.size = 1;
+		x.isNegative = false;
 	}
 	~Bigint()
 	{
-		delete[] row;
+		__free_row(row);
 	}
 	void load(const char* input_);
 	void print();
 	void extract(char *target_);
 	void cutHalf();
-	bool operator<(const Bigint &x);
-	bool operator==(const Bigint &x);
-	bool isOdd()
+	void reserve(int digits);
+	void shrinkToFit();
+	int getCapacity()
+	{
+		return capacity - 1;
+	}
+	bool operator<(const Bigint &x) const;
+	bool operator==(const Bigint &x) const;
+	int compare(const Bigint &x) const;
+	size_t hash() const;
+	bool isOdd() const
 	{
 		if (row[0] == 0 || row[0] == 2 || row[0] == 4 || row[0] == 6 || row[0] == 8)
 			return false;
 		else
 			return true;
 	}
-	bool isZero()
+	bool isZero() const
 	{
 		if (size == 1 && row[0] == 0)
 			return true;
@@ -143,8 +651,64 @@ public:
 	Bigint operator-(const Bigint &x);
 	Bigint operator*(const Bigint &x);
 	Bigint operator%(const Bigint &x);
+	static Bigint product(const Bigint *first, const Bigint *last, bool parallel = false);
+	static Bigint factorial(int n, bool parallel = false);
+	static Bigint binomial(int n, int k, bool parallel = false);
+	static Bigint small(long long x);
+	static const Bigint & constant(int x);
+	static const Bigint & powerOfTwo(int k);
+	static const Bigint & powerOfTen(int k);
+	std::string toString(int radix = 10) const;
+	static Bigint fromString(const char *input_, int radix = 10);
+	static std::future<Bigint> multiplyAsync(const Bigint &a, const Bigint &b,
+		std::shared_ptr<BigintJob> job = std::shared_ptr<BigintJob>(), BigintExecutor &executor = BigintExecutor::shared());
+	static std::future<Bigint> moduloAsync(const Bigint &a, const Bigint &b,
+		std::shared_ptr<BigintJob> job = std::shared_ptr<BigintJob>(), BigintExecutor &executor = BigintExecutor::shared());
+	static std::future<Bigint> productAsync(const Bigint *first, const Bigint *last, bool parallel = false,
+		std::shared_ptr<BigintJob> job = std::shared_ptr<BigintJob>(), BigintExecutor &executor = BigintExecutor::shared());
+	static std::future<Bigint> factorialAsync(int n, bool parallel = false,
+		std::shared_ptr<BigintJob> job = std::shared_ptr<BigintJob>(), BigintExecutor &executor = BigintExecutor::shared());
+	static BigintStats statistics();
+	static void resetStatistics();
 };
 
+template <class Task>
+std::future<Bigint> BigintExecutor::submit(std::shared_ptr<BigintJob> job, Task task, long long steps)
+{
+	if (!job)
+		job = std::make_shared<BigintJob>();
+	std::shared_ptr<std::packaged_task<Bigint()> > packaged = std::make_shared<std::packaged_task<Bigint()> >(
+		[job, task, steps]() mutable
+		{
+			__bigint_job_slot &slot = __bigint_current_job();
+			__bigint_job_slot saved = slot;
+			slot.job = job.get();
+			slot.quiet = steps != 0;
+			job->__begin(steps);
+			try
+			{
+				__bigint_checkpoint(0, 0);
+				Bigint result = task();
+				slot = saved;
+				job->__report(1);
+				return result;
+			}
+			catch (...)
+			{
+				slot = saved;
+				throw;
+			}
+		});
+	std::future<Bigint> result = packaged->get_future();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		__queued queued = { job, [packaged] { (*packaged)(); } };
+		queue.push_back(queued);
+	}
+	wake.notify_one();
+	return result;
+}
+
 bool Bigint::__abs_smaller_than(const Bigint &a, const Bigint &b)
 {
 	if (a.size < b.size)
@@ -166,76 +730,79 @@ bool Bigint::__abs_smaller_than(const Bigint &a, const Bigint &b)
 
 Bigint Bigint::__plain_add(const Bigint &a, const Bigint &b)
 {
+	BIGINT_STAT_SCOPE(__STAT_ADD, a.size > b.size ? a.size : b.size);
 	if (a.size > b.size)
 	{
 		Bigint temp(a.size + 2);
-		temp = a;
+		temp.__assign_digits(a);
 
 #if defined AVX
-		int round = b.size / 32;
-		int rest = b.size - round * 32;
-		__m256i loader1, loader2, loader3, loader4;
-		__m256i *pb = reinterpret_cast<__m256i*>(b.row);
-		__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
-		for (int i = 0; i < round; ++i)
-		{
-			loader1 = _mm256_add_epi32(_mm256_loadu_si256(pb), _mm256_loadu_si256(ptemp));
-			loader2 = _mm256_add_epi32(_mm256_loadu_si256(pb + 1), _mm256_loadu_si256(ptemp + 1));
-			loader3 = _mm256_add_epi32(_mm256_loadu_si256(pb + 2), _mm256_loadu_si256(ptemp + 2));
-			loader4 = _mm256_add_epi32(_mm256_loadu_si256(pb + 3), _mm256_loadu_si256(ptemp + 3));
-			_mm256_storeu_si256(ptemp, loader1);
-			_mm256_storeu_si256(ptemp + 1, loader2);
-			_mm256_storeu_si256(ptemp + 2, loader3);
-			_mm256_storeu_si256(ptemp + 3, loader4);
-			pb += 4;
-			ptemp += 4;
-		}
-		round = (b.size - round * 32) / 8;
-		rest -= round * 8;
-		for (int i = 0; i < round; ++i)
+		if (b.size >= tuning().addSimdMinDigits)
 		{
-			loader1 = _mm256_add_epi32(_mm256_loadu_si256(pb), _mm256_loadu_si256(ptemp));
-			_mm256_storeu_si256(ptemp, loader1);
-			pb += 1;
-			ptemp += 1;
+			int vecCount = (b.size + 7) / 8;
+			int round = vecCount / 4;
+			int rest = vecCount - round * 4;
+			__m256i loader1, loader2, loader3, loader4;
+			__m256i *pb = reinterpret_cast<__m256i*>(b.row);
+			__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
+			for (int i = 0; i < round; ++i)
+			{
+				loader1 = _mm256_add_epi32(_mm256_load_si256(pb), _mm256_load_si256(ptemp));
+				loader2 = _mm256_add_epi32(_mm256_load_si256(pb + 1), _mm256_load_si256(ptemp + 1));
+				loader3 = _mm256_add_epi32(_mm256_load_si256(pb + 2), _mm256_load_si256(ptemp + 2));
+				loader4 = _mm256_add_epi32(_mm256_load_si256(pb + 3), _mm256_load_si256(ptemp + 3));
+				_mm256_store_si256(ptemp, loader1);
+				_mm256_store_si256(ptemp + 1, loader2);
+				_mm256_store_si256(ptemp + 2, loader3);
+				_mm256_store_si256(ptemp + 3, loader4);
+				pb += 4;
+				ptemp += 4;
+			}
+			for (int i = 0; i < rest; ++i)
+			{
+				loader1 = _mm256_add_epi32(_mm256_load_si256(pb), _mm256_load_si256(ptemp));
+				_mm256_store_si256(ptemp, loader1);
+				pb += 1;
+				ptemp += 1;
+			}
 		}
-		for (int i = b.size - rest; i < b.size; ++i)
-			temp.row[i] += b.row[i];
-
+		else
 #elif defined SSE
-		int round = b.size / 16;
-		int rest = b.size - round * 16;
-		__m128i loader1, loader2, loader3, loader4;
-		__m128i *pb = reinterpret_cast<__m128i*>(b.row);
-		__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
-		for (int i = 0; i < round; ++i)
+		if (b.size >= tuning().addSimdMinDigits)
 		{
-			loader1 = _mm_add_epi32(_mm_loadu_si128(pb), _mm_loadu_si128(ptemp));
-			loader2 = _mm_add_epi32(_mm_loadu_si128(pb + 1), _mm_loadu_si128(ptemp + 1));
-			loader3 = _mm_add_epi32(_mm_loadu_si128(pb + 2), _mm_loadu_si128(ptemp + 2));
-			loader4 = _mm_add_epi32(_mm_loadu_si128(pb + 3), _mm_loadu_si128(ptemp + 3));
-			_mm_storeu_si128(ptemp, loader1);
-			_mm_storeu_si128(ptemp + 1, loader2);
-			_mm_storeu_si128(ptemp + 2, loader3);
-			_mm_storeu_si128(ptemp + 3, loader4);
-			pb += 4;
-			ptemp += 4;
+			int vecCount = (b.size + 3) / 4;
+			int round = vecCount / 4;
+			int rest = vecCount - round * 4;
+			__m128i loader1, loader2, loader3, loader4;
+			__m128i *pb = reinterpret_cast<__m128i*>(b.row);
+			__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
+			for (int i = 0; i < round; ++i)
+			{
+				loader1 = _mm_add_epi32(_mm_load_si128(pb), _mm_load_si128(ptemp));
+				loader2 = _mm_add_epi32(_mm_load_si128(pb + 1), _mm_load_si128(ptemp + 1));
+				loader3 = _mm_add_epi32(_mm_load_si128(pb + 2), _mm_load_si128(ptemp + 2));
+				loader4 = _mm_add_epi32(_mm_load_si128(pb + 3), _mm_load_si128(ptemp + 3));
+				_mm_store_si128(ptemp, loader1);
+				_mm_store_si128(ptemp + 1, loader2);
+				_mm_store_si128(ptemp + 2, loader3);
+				_mm_store_si128(ptemp + 3, loader4);
+				pb += 4;
+				ptemp += 4;
+			}
+			for (int i = 0; i < rest; ++i)
+			{
+				loader1 = _mm_add_epi32(_mm_load_si128(pb), _mm_load_si128(ptemp));
+				_mm_store_si128(ptemp, loader1);
+				pb += 1;
+				ptemp += 1;
+			}
 		}
-		round = (b.size - round * 16) / 4;
-		rest -= round * 4;
-		for (int i = 0; i < round; ++i)
+		else
+#endif
 		{
-			loader1 = _mm_add_epi32(_mm_loadu_si128(pb), _mm_loadu_si128(ptemp));
-			_mm_storeu_si128(ptemp, loader1);
-			pb += 1;
-			ptemp += 1;
+			for (int i = 0; i < b.size; ++i)
+				temp.row[i] += b.row[i];
 		}
-		for (int i = b.size - rest; i < b.size; ++i)
-			temp.row[i] += b.row[i];
-#else
-		for (int i = 0; i < b.size; ++i)
-			temp.row[i] += b.row[i];
-#endif
 
 		for (int i = 0; i < a.size; ++i)
 		{
@@ -252,72 +819,76 @@ Bigint Bigint::__plain_add(const Bigint &a, const Bigint &b)
 	else
 	{
 		Bigint temp(b.size + 2);
-		temp = b;
+		temp.__assign_digits(b);
 
 #if defined AVX
-		int round = a.size / 32;
-		int rest = a.size - round * 32;
-		__m256i loader1, loader2, loader3, loader4;
-		__m256i *pa = reinterpret_cast<__m256i*>(a.row);
-		__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
-		for (int i = 0; i < round; ++i)
-		{
-			loader1 = _mm256_add_epi32(_mm256_loadu_si256(pa), _mm256_loadu_si256(ptemp));
-			loader2 = _mm256_add_epi32(_mm256_loadu_si256(pa + 1), _mm256_loadu_si256(ptemp + 1));
-			loader3 = _mm256_add_epi32(_mm256_loadu_si256(pa + 2), _mm256_loadu_si256(ptemp + 2));
-			loader4 = _mm256_add_epi32(_mm256_loadu_si256(pa + 3), _mm256_loadu_si256(ptemp + 3));
-			_mm256_storeu_si256(ptemp, loader1);
-			_mm256_storeu_si256(ptemp + 1, loader2);
-			_mm256_storeu_si256(ptemp + 2, loader3);
-			_mm256_storeu_si256(ptemp + 3, loader4);
-			pa += 4;
-			ptemp += 4;
-		}
-		round = (a.size - round * 32) / 8;
-		rest -= round * 8;
-		for (int i = 0; i < round; ++i)
+		if (a.size >= tuning().addSimdMinDigits)
 		{
-			loader1 = _mm256_add_epi32(_mm256_loadu_si256(pa), _mm256_loadu_si256(ptemp));
-			_mm256_storeu_si256(ptemp, loader1);
-			pa += 1;
-			ptemp += 1;
+			int vecCount = (a.size + 7) / 8;
+			int round = vecCount / 4;
+			int rest = vecCount - round * 4;
+			__m256i loader1, loader2, loader3, loader4;
+			__m256i *pa = reinterpret_cast<__m256i*>(a.row);
+			__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
+			for (int i = 0; i < round; ++i)
+			{
+				loader1 = _mm256_add_epi32(_mm256_load_si256(pa), _mm256_load_si256(ptemp));
+				loader2 = _mm256_add_epi32(_mm256_load_si256(pa + 1), _mm256_load_si256(ptemp + 1));
+				loader3 = _mm256_add_epi32(_mm256_load_si256(pa + 2), _mm256_load_si256(ptemp + 2));
+				loader4 = _mm256_add_epi32(_mm256_load_si256(pa + 3), _mm256_load_si256(ptemp + 3));
+				_mm256_store_si256(ptemp, loader1);
+				_mm256_store_si256(ptemp + 1, loader2);
+				_mm256_store_si256(ptemp + 2, loader3);
+				_mm256_store_si256(ptemp + 3, loader4);
+				pa += 4;
+				ptemp += 4;
+			}
+			for (int i = 0; i < rest; ++i)
+			{
+				loader1 = _mm256_add_epi32(_mm256_load_si256(pa), _mm256_load_si256(ptemp));
+				_mm256_store_si256(ptemp, loader1);
+				pa += 1;
+				ptemp += 1;
+			}
 		}
-		for (int i = a.size - rest; i < a.size; ++i)
-			temp.row[i] += a.row[i];
+		else
 #elif defined SSE
-		int round = a.size / 16;
-		int rest = a.size - round * 16;
-		__m128i loader1, loader2, loader3, loader4;
-		__m128i *pa = reinterpret_cast<__m128i*>(a.row);
-		__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
-		for (int i = 0; i < round; ++i)
+		if (a.size >= tuning().addSimdMinDigits)
 		{
-			loader1 = _mm_add_epi32(_mm_loadu_si128(pa), _mm_loadu_si128(ptemp));
-			loader2 = _mm_add_epi32(_mm_loadu_si128(pa + 1), _mm_loadu_si128(ptemp + 1));
-			loader3 = _mm_add_epi32(_mm_loadu_si128(pa + 2), _mm_loadu_si128(ptemp + 2));
-			loader4 = _mm_add_epi32(_mm_loadu_si128(pa + 3), _mm_loadu_si128(ptemp + 3));
-			_mm_storeu_si128(ptemp, loader1);
-			_mm_storeu_si128(ptemp + 1, loader2);
-			_mm_storeu_si128(ptemp + 2, loader3);
-			_mm_storeu_si128(ptemp + 3, loader4);
-			pa += 4;
-			ptemp += 4;
+			int vecCount = (a.size + 3) / 4;
+			int round = vecCount / 4;
+			int rest = vecCount - round * 4;
+			__m128i loader1, loader2, loader3, loader4;
+			__m128i *pa = reinterpret_cast<__m128i*>(a.row);
+			__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
+			for (int i = 0; i < round; ++i)
+			{
+				loader1 = _mm_add_epi32(_mm_load_si128(pa), _mm_load_si128(ptemp));
+				loader2 = _mm_add_epi32(_mm_load_si128(pa + 1), _mm_load_si128(ptemp + 1));
+				loader3 = _mm_add_epi32(_mm_load_si128(pa + 2), _mm_load_si128(ptemp + 2));
+				loader4 = _mm_add_epi32(_mm_load_si128(pa + 3), _mm_load_si128(ptemp + 3));
+				_mm_store_si128(ptemp, loader1);
+				_mm_store_si128(ptemp + 1, loader2);
+				_mm_store_si128(ptemp + 2, loader3);
+				_mm_store_si128(ptemp + 3, loader4);
+				pa += 4;
+				ptemp += 4;
+			}
+			for (int i = 0; i < rest; ++i)
+			{
+				loader1 = _mm_add_epi32(_mm_load_si128(pa), _mm_load_si128(ptemp));
+				_mm_store_si128(ptemp, loader1);
+				pa += 1;
+				ptemp += 1;
+			}
 		}
-		round = (a.size - round * 16) / 4;
-		rest -= round * 4;
-		for (int i = 0; i < round; ++i)
+		else
+#endif
 		{
-			loader1 = _mm_add_epi32(_mm_loadu_si128(pa), _mm_loadu_si128(ptemp));
-			_mm_storeu_si128(ptemp, loader1);
-			pa += 1;
-			ptemp += 1;
+			for (int i = 0; i < a.size; ++i)
+				temp.row[i] += a.row[i];
 		}
-		for (int i = a.size - rest; i < a.size; ++i)
-			temp.row[i] += a.row[i];
-#else
-		for (int i = 0; i < a.size; ++i)
-			temp.row[i] += a.row[i];
-#endif
+
 		for (int i = 0; i < b.size; ++i)
 		{
 			if (temp.row[i] >= 10)
@@ -334,73 +905,76 @@ Bigint Bigint::__plain_add(const Bigint &a, const Bigint &b)
 
 Bigint Bigint::__plain_subtract(const Bigint &a, const Bigint &b)
 {
-
+	BIGINT_STAT_SCOPE(__STAT_SUBTRACT, a.size);
 	Bigint temp(a.size + 2);
-	temp = a;
+	temp.__assign_digits(a);
 #if defined AVX
-	int round = b.size / 32;
-	int rest = b.size - round * 32;
-	__m256i loader1, loader2, loader3, loader4;
-	__m256i *pb = reinterpret_cast<__m256i*>(b.row);
-	__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
-	for (int i = 0; i < round; ++i)
-	{
-		loader1 = _mm256_sub_epi32(_mm256_loadu_si256(ptemp), _mm256_loadu_si256(pb));
-		loader2 = _mm256_sub_epi32(_mm256_loadu_si256(ptemp + 1), _mm256_loadu_si256(pb + 1));
-		loader3 = _mm256_sub_epi32(_mm256_loadu_si256(ptemp + 2), _mm256_loadu_si256(pb + 2));
-		loader4 = _mm256_sub_epi32(_mm256_loadu_si256(ptemp + 3), _mm256_loadu_si256(pb + 3));
-		_mm256_storeu_si256(ptemp, loader1);
-		_mm256_storeu_si256(ptemp + 1, loader2);
-		_mm256_storeu_si256(ptemp + 2, loader3);
-		_mm256_storeu_si256(ptemp + 3, loader4);
-		pb += 4;
-		ptemp += 4;
-	}
-	round = (b.size - round * 32) / 8;
-	rest -= round * 8;
-	for (int i = 0; i < round; ++i)
-	{
-		loader1 = _mm256_sub_epi32(_mm256_loadu_si256(ptemp), _mm256_loadu_si256(pb));
-		_mm256_storeu_si256(ptemp, loader1);
-		pb += 1;
-		ptemp += 1;
-	}
-	for (int i = b.size - rest; i < b.size; ++i)
-		temp.row[i] -= b.row[i];
+	if (b.size >= tuning().addSimdMinDigits)
+	{
+		int vecCount = (b.size + 7) / 8;
+		int round = vecCount / 4;
+		int rest = vecCount - round * 4;
+		__m256i loader1, loader2, loader3, loader4;
+		__m256i *pb = reinterpret_cast<__m256i*>(b.row);
+		__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
+		for (int i = 0; i < round; ++i)
+		{
+			loader1 = _mm256_sub_epi32(_mm256_load_si256(ptemp), _mm256_load_si256(pb));
+			loader2 = _mm256_sub_epi32(_mm256_load_si256(ptemp + 1), _mm256_load_si256(pb + 1));
+			loader3 = _mm256_sub_epi32(_mm256_load_si256(ptemp + 2), _mm256_load_si256(pb + 2));
+			loader4 = _mm256_sub_epi32(_mm256_load_si256(ptemp + 3), _mm256_load_si256(pb + 3));
+			_mm256_store_si256(ptemp, loader1);
+			_mm256_store_si256(ptemp + 1, loader2);
+			_mm256_store_si256(ptemp + 2, loader3);
+			_mm256_store_si256(ptemp + 3, loader4);
+			pb += 4;
+			ptemp += 4;
+		}
+		for (int i = 0; i < rest; ++i)
+		{
+			loader1 = _mm256_sub_epi32(_mm256_load_si256(ptemp), _mm256_load_si256(pb));
+			_mm256_store_si256(ptemp, loader1);
+			pb += 1;
+			ptemp += 1;
+		}
+	}
+	else
 #elif defined SSE
-	int round = b.size / 16;
-	int rest = b.size - round * 16;
-	__m128i loader1, loader2, loader3, loader4;
-	__m128i *pb = reinterpret_cast<__m128i*>(b.row);
-	__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
-	for (int i = 0; i < round; ++i)
-	{
-		loader1 = _mm_sub_epi32(_mm_loadu_si128(ptemp), _mm_loadu_si128(pb));
-		loader2 = _mm_sub_epi32(_mm_loadu_si128(ptemp + 1), _mm_loadu_si128(pb + 1));
-		loader3 = _mm_sub_epi32(_mm_loadu_si128(ptemp + 2), _mm_loadu_si128(pb + 2));
-		loader4 = _mm_sub_epi32(_mm_loadu_si128(ptemp + 3), _mm_loadu_si128(pb + 3));
-		_mm_storeu_si128(ptemp, loader1);
-		_mm_storeu_si128(ptemp + 1, loader2);
-		_mm_storeu_si128(ptemp + 2, loader3);
-		_mm_storeu_si128(ptemp + 3, loader4);
-		pb += 4;
-		ptemp += 4;
-	}
-	round = (b.size - round * 16) / 4;
-	rest -= round * 4;
-	for (int i = 0; i < round; ++i)
-	{
-		loader1 = _mm_sub_epi32(_mm_loadu_si128(ptemp), _mm_loadu_si128(pb));
-		_mm_storeu_si128(ptemp, loader1);
-		pb += 1;
-		ptemp += 1;
-	}
-	for (int i = b.size - rest; i < b.size; ++i)
-		temp.row[i] -= b.row[i];
-#else
-	for (int i = b.size - 1; i >= 0; --i)
-		temp.row[i] -= b.row[i];
+	if (b.size >= tuning().addSimdMinDigits)
+	{
+		int vecCount = (b.size + 3) / 4;
+		int round = vecCount / 4;
+		int rest = vecCount - round * 4;
+		__m128i loader1, loader2, loader3, loader4;
+		__m128i *pb = reinterpret_cast<__m128i*>(b.row);
+		__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
+		for (int i = 0; i < round; ++i)
+		{
+			loader1 = _mm_sub_epi32(_mm_load_si128(ptemp), _mm_load_si128(pb));
+			loader2 = _mm_sub_epi32(_mm_load_si128(ptemp + 1), _mm_load_si128(pb + 1));
+			loader3 = _mm_sub_epi32(_mm_load_si128(ptemp + 2), _mm_load_si128(pb + 2));
+			loader4 = _mm_sub_epi32(_mm_load_si128(ptemp + 3), _mm_load_si128(pb + 3));
+			_mm_store_si128(ptemp, loader1);
+			_mm_store_si128(ptemp + 1, loader2);
+			_mm_store_si128(ptemp + 2, loader3);
+			_mm_store_si128(ptemp + 3, loader4);
+			pb += 4;
+			ptemp += 4;
+		}
+		for (int i = 0; i < rest; ++i)
+		{
+			loader1 = _mm_sub_epi32(_mm_load_si128(ptemp), _mm_load_si128(pb));
+			_mm_store_si128(ptemp, loader1);
+			pb += 1;
+			ptemp += 1;
+		}
+	}
+	else
 #endif
+	{
+		for (int i = b.size - 1; i >= 0; --i)
+			temp.row[i] -= b.row[i];
+	}
 	for (int i = 0; i < a.size; ++i)
 	{
 		if (temp.row[i] < 0)
@@ -424,393 +998,372 @@ Bigint Bigint::__plain_subtract(const Bigint &a, const Bigint &b)
 
 Bigint Bigint::__plain_multiply(const Bigint &a, const Bigint &b)
 {
-	Bigint temp(a.size + b.size + 3);
-	if (__abs_smaller_than(a, b))
+#if defined AVX || defined SSE
+	BIGINT_STAT_SCOPE((__abs_smaller_than(a, b) ? b.size : a.size) >= tuning().mulSimdMinDigits ? __STAT_MULTIPLY_SIMD : __STAT_MULTIPLY_PLAIN, (long long)a.size * b.size);
+#else
+	BIGINT_STAT_SCOPE(__STAT_MULTIPLY_PLAIN, (long long)a.size * b.size);
+#endif
+	Bigint temp(a.size + b.size + 8);
+	int carrySweep = tuning().carrySweep;
+	if (__abs_smaller_than(a, b))
 	{
 #if defined AVX
-		__m256i loader1, loader2, loader3, loader4, factor;
-		__m256i *pb = reinterpret_cast<__m256i*>(b.row);
-		__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
-		int bigRound = b.size / 32;
-		int smallRound = (b.size - bigRound * 32) / 8;
-		int rest = b.size - bigRound * 32 - smallRound * 8;
-		int threshold = 0;
-		for (int i = 0; i < a.size; ++i)
+		if (b.size >= tuning().mulSimdMinDigits)
 		{
-			pb = reinterpret_cast<__m256i*>(b.row);
-			ptemp = reinterpret_cast<__m256i*>(temp.row + i);
-			factor = _mm256_set1_epi32(a.row[i]);
-			for (int j = 0; j < bigRound; ++j)
-			{
-				loader1 = _mm256_mullo_epi32(_mm256_loadu_si256(pb), factor);
-				loader2 = _mm256_mullo_epi32(_mm256_loadu_si256(pb + 1), factor);
-				loader3 = _mm256_mullo_epi32(_mm256_loadu_si256(pb + 2), factor);
-				loader4 = _mm256_mullo_epi32(_mm256_loadu_si256(pb + 3), factor);
-				loader1 = _mm256_add_epi32(loader1, *ptemp);
-				loader2 = _mm256_add_epi32(loader2, *(ptemp + 1));
-				loader3 = _mm256_add_epi32(loader3, *(ptemp + 2));
-				loader4 = _mm256_add_epi32(loader4, *(ptemp + 3));
-				_mm256_storeu_si256(ptemp, loader1);
-				_mm256_storeu_si256(ptemp + 1, loader2);
-				_mm256_storeu_si256(ptemp + 2, loader3);
-				_mm256_storeu_si256(ptemp + 3, loader4);
-				pb += 4;
-				ptemp += 4;
-				threshold += 32;
-				if (threshold > 1000000)
-				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
-					{
-						if (temp.row[i] >= 10)
-						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
-						}
-					}
-				}
-			}
-			for (int j = 0; j < smallRound; ++j)
+			__m256i loader1, loader2, loader3, loader4, factor;
+			__m256i *pb = reinterpret_cast<__m256i*>(b.row);
+			__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
+			int vecCount = (b.size + 7) / 8;
+			int bigRound = vecCount / 4;
+			int smallRound = vecCount - bigRound * 4;
+			int threshold = 0;
+			for (int i = 0; i < a.size; ++i)
 			{
-				loader1 = _mm256_mullo_epi32(_mm256_loadu_si256(pb), factor);
-				loader1 = _mm256_add_epi32(loader1, *ptemp);
-				_mm256_storeu_si256(ptemp, loader1);
-				pb += 1;
-				ptemp += 1;
-				threshold += 8;
-				if (threshold > 1000000)
+				pb = reinterpret_cast<__m256i*>(b.row);
+				ptemp = reinterpret_cast<__m256i*>(temp.row + i);
+				factor = _mm256_set1_epi32(a.row[i]);
+				for (int j = 0; j < bigRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm256_mullo_epi32(_mm256_load_si256(pb), factor);
+					loader2 = _mm256_mullo_epi32(_mm256_load_si256(pb + 1), factor);
+					loader3 = _mm256_mullo_epi32(_mm256_load_si256(pb + 2), factor);
+					loader4 = _mm256_mullo_epi32(_mm256_load_si256(pb + 3), factor);
+					loader1 = _mm256_add_epi32(loader1, _mm256_loadu_si256(ptemp));
+					loader2 = _mm256_add_epi32(loader2, _mm256_loadu_si256(ptemp + 1));
+					loader3 = _mm256_add_epi32(loader3, _mm256_loadu_si256(ptemp + 2));
+					loader4 = _mm256_add_epi32(loader4, _mm256_loadu_si256(ptemp + 3));
+					_mm256_storeu_si256(ptemp, loader1);
+					_mm256_storeu_si256(ptemp + 1, loader2);
+					_mm256_storeu_si256(ptemp + 2, loader3);
+					_mm256_storeu_si256(ptemp + 3, loader4);
+					pb += 4;
+					ptemp += 4;
+					threshold += 32;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, a.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
-			}
-			for (int j = b.size - rest; j < b.size; ++j)
-			{
-				temp.row[i + j] += b.row[j] * a.row[i];
-				threshold += 1;
-				if (threshold > 1000000)
+				for (int j = 0; j < smallRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm256_mullo_epi32(_mm256_load_si256(pb), factor);
+					loader1 = _mm256_add_epi32(loader1, _mm256_loadu_si256(ptemp));
+					_mm256_storeu_si256(ptemp, loader1);
+					pb += 1;
+					ptemp += 1;
+					threshold += 8;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, a.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
 			}
 		}
+		else
 #elif defined SSE
-		__m128i loader1, loader2, loader3, loader4, factor;
-		__m128i *pb = reinterpret_cast<__m128i*>(b.row);
-		__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
-		int bigRound = b.size / 16;
-		int smallRound = (b.size - bigRound * 16) / 4;
-		int rest = b.size - bigRound * 16 - smallRound * 4;
-		int threshold = 0;
-		for (int i = 0; i < a.size; ++i)
+		if (b.size >= tuning().mulSimdMinDigits)
 		{
-			factor = _mm_set1_epi32(a.row[i]);
-			pb = reinterpret_cast<__m128i*>(b.row);
-			ptemp = reinterpret_cast<__m128i*>(temp.row + i);
-			for (int j = 0; j < bigRound; ++j)
-			{
-				loader1 = _mm_mullo_epi32(_mm_loadu_si128(pb), factor);
-				loader2 = _mm_mullo_epi32(_mm_loadu_si128(pb + 1), factor);
-				loader3 = _mm_mullo_epi32(_mm_loadu_si128(pb + 2), factor);
-				loader4 = _mm_mullo_epi32(_mm_loadu_si128(pb + 3), factor);
-				loader1 = _mm_add_epi32(loader1, *ptemp);
-				loader2 = _mm_add_epi32(loader2, *(ptemp + 1));
-				loader3 = _mm_add_epi32(loader3, *(ptemp + 2));
-				loader4 = _mm_add_epi32(loader4, *(ptemp + 3));
-				_mm_storeu_si128(ptemp, loader1);
-				_mm_storeu_si128(ptemp + 1, loader2);
-				_mm_storeu_si128(ptemp + 2, loader3);
-				_mm_storeu_si128(ptemp + 3, loader4);
-				pb += 4;
-				ptemp += 4;
-				threshold += 16;
-				if (threshold > 1000000)
-				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
-					{
-						if (temp.row[i] >= 10)
-						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
-						}
-					}
-				}
-			}
-			for (int j = 0; j < smallRound; ++j)
+			__m128i loader1, loader2, loader3, loader4, factor;
+			__m128i *pb = reinterpret_cast<__m128i*>(b.row);
+			__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
+			int vecCount = (b.size + 3) / 4;
+			int bigRound = vecCount / 4;
+			int smallRound = vecCount - bigRound * 4;
+			int threshold = 0;
+			for (int i = 0; i < a.size; ++i)
 			{
-				loader1 = _mm_mullo_epi32(_mm_loadu_si128(pb), factor);
-				loader1 = _mm_add_epi32(loader1, *ptemp);
-				_mm_storeu_si128(ptemp, loader1);
-				pb += 1;
-				ptemp += 1;
-				threshold += 4;
-				if (threshold > 1000000)
+				pb = reinterpret_cast<__m128i*>(b.row);
+				ptemp = reinterpret_cast<__m128i*>(temp.row + i);
+				factor = _mm_set1_epi32(a.row[i]);
+				for (int j = 0; j < bigRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm_mullo_epi32(_mm_load_si128(pb), factor);
+					loader2 = _mm_mullo_epi32(_mm_load_si128(pb + 1), factor);
+					loader3 = _mm_mullo_epi32(_mm_load_si128(pb + 2), factor);
+					loader4 = _mm_mullo_epi32(_mm_load_si128(pb + 3), factor);
+					loader1 = _mm_add_epi32(loader1, _mm_loadu_si128(ptemp));
+					loader2 = _mm_add_epi32(loader2, _mm_loadu_si128(ptemp + 1));
+					loader3 = _mm_add_epi32(loader3, _mm_loadu_si128(ptemp + 2));
+					loader4 = _mm_add_epi32(loader4, _mm_loadu_si128(ptemp + 3));
+					_mm_storeu_si128(ptemp, loader1);
+					_mm_storeu_si128(ptemp + 1, loader2);
+					_mm_storeu_si128(ptemp + 2, loader3);
+					_mm_storeu_si128(ptemp + 3, loader4);
+					pb += 4;
+					ptemp += 4;
+					threshold += 16;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, a.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
-			}
-			for (int j = b.size - rest; j < b.size; ++j)
-			{
-				temp.row[i + j] += b.row[j] * a.row[i];
-				threshold += 1;
-				if (threshold > 1000000)
+				for (int j = 0; j < smallRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm_mullo_epi32(_mm_load_si128(pb), factor);
+					loader1 = _mm_add_epi32(loader1, _mm_loadu_si128(ptemp));
+					_mm_storeu_si128(ptemp, loader1);
+					pb += 1;
+					ptemp += 1;
+					threshold += 4;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, a.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
 			}
 		}
-#else
-		int threshold = 0;
-		for (int i = 0; i < a.size; ++i)
+		else
+#endif
 		{
-			for (int j = 0; j < b.size; ++j)
+			int threshold = 0;
+			for (int i = 0; i < a.size; ++i)
 			{
-				temp.row[i + j] += b.row[j] * a.row[i];
-				threshold += 1;
-				if (threshold > 1000000)
+				for (int j = 0; j < b.size; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					temp.row[i + j] += b.row[j] * a.row[i];
+					threshold += 1;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, a.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
 			}
 		}
-#endif
 	}
 	else
 	{
 #if defined AVX
-		__m256i loader1, loader2, loader3, loader4, factor;
-		__m256i *pa = reinterpret_cast<__m256i*>(a.row);
-		__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
-		int bigRound = a.size / 32;
-		int smallRound = (a.size - bigRound * 32) / 8;
-		int rest = a.size - bigRound * 32 - smallRound * 8;
-		int threshold = 0;
-		for (int i = 0; i < b.size; ++i)
+		if (a.size >= tuning().mulSimdMinDigits)
 		{
-			pa = reinterpret_cast<__m256i*>(a.row);
-			ptemp = reinterpret_cast<__m256i*>(temp.row + i);
-			factor = _mm256_set1_epi32(b.row[i]);
-			for (int j = 0; j < bigRound; ++j)
-			{
-				loader1 = _mm256_mullo_epi32(_mm256_loadu_si256(pa), factor);
-				loader2 = _mm256_mullo_epi32(_mm256_loadu_si256(pa + 1), factor);
-				loader3 = _mm256_mullo_epi32(_mm256_loadu_si256(pa + 2), factor);
-				loader4 = _mm256_mullo_epi32(_mm256_loadu_si256(pa + 3), factor);
-				loader1 = _mm256_add_epi32(loader1, *ptemp);
-				loader2 = _mm256_add_epi32(loader2, *(ptemp + 1));
-				loader3 = _mm256_add_epi32(loader3, *(ptemp + 2));
-				loader4 = _mm256_add_epi32(loader4, *(ptemp + 3));
-				_mm256_storeu_si256(ptemp, loader1);
-				_mm256_storeu_si256(ptemp + 1, loader2);
-				_mm256_storeu_si256(ptemp + 2, loader3);
-				_mm256_storeu_si256(ptemp + 3, loader4);
-				pa += 4;
-				ptemp += 4;
-				threshold += 32;
-				if (threshold > 1000000)
-				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
-					{
-						if (temp.row[i] >= 10)
-						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
-						}
-					}
-				}
-			}
-			for (int j = 0; j < smallRound; ++j)
+			__m256i loader1, loader2, loader3, loader4, factor;
+			__m256i *pa = reinterpret_cast<__m256i*>(a.row);
+			__m256i *ptemp = reinterpret_cast<__m256i*>(temp.row);
+			int vecCount = (a.size + 7) / 8;
+			int bigRound = vecCount / 4;
+			int smallRound = vecCount - bigRound * 4;
+			int threshold = 0;
+			for (int i = 0; i < b.size; ++i)
 			{
-				loader1 = _mm256_mullo_epi32(_mm256_loadu_si256(pa), factor);
-				loader1 = _mm256_add_epi32(loader1, *ptemp);
-				_mm256_storeu_si256(ptemp, loader1);
-				pa += 1;
-				ptemp += 1;
-				threshold += 8;
-				if (threshold > 1000000)
+				pa = reinterpret_cast<__m256i*>(a.row);
+				ptemp = reinterpret_cast<__m256i*>(temp.row + i);
+				factor = _mm256_set1_epi32(b.row[i]);
+				for (int j = 0; j < bigRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm256_mullo_epi32(_mm256_load_si256(pa), factor);
+					loader2 = _mm256_mullo_epi32(_mm256_load_si256(pa + 1), factor);
+					loader3 = _mm256_mullo_epi32(_mm256_load_si256(pa + 2), factor);
+					loader4 = _mm256_mullo_epi32(_mm256_load_si256(pa + 3), factor);
+					loader1 = _mm256_add_epi32(loader1, _mm256_loadu_si256(ptemp));
+					loader2 = _mm256_add_epi32(loader2, _mm256_loadu_si256(ptemp + 1));
+					loader3 = _mm256_add_epi32(loader3, _mm256_loadu_si256(ptemp + 2));
+					loader4 = _mm256_add_epi32(loader4, _mm256_loadu_si256(ptemp + 3));
+					_mm256_storeu_si256(ptemp, loader1);
+					_mm256_storeu_si256(ptemp + 1, loader2);
+					_mm256_storeu_si256(ptemp + 2, loader3);
+					_mm256_storeu_si256(ptemp + 3, loader4);
+					pa += 4;
+					ptemp += 4;
+					threshold += 32;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, b.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
-			}
-			for (int j = a.size - rest; j < a.size; ++j)
-			{
-				temp.row[i + j] += a.row[j] * b.row[i];
-				threshold += 1;
-				if (threshold > 1000000)
+				for (int j = 0; j < smallRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm256_mullo_epi32(_mm256_load_si256(pa), factor);
+					loader1 = _mm256_add_epi32(loader1, _mm256_loadu_si256(ptemp));
+					_mm256_storeu_si256(ptemp, loader1);
+					pa += 1;
+					ptemp += 1;
+					threshold += 8;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, b.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
 			}
 		}
+		else
 #elif defined SSE
-		__m128i loader1, loader2, loader3, loader4, factor;
-		__m128i *pa = reinterpret_cast<__m128i*>(a.row);
-		__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
-		int bigRound = a.size / 16;
-		int smallRound = (a.size - bigRound * 16) / 4;
-		int rest = a.size - bigRound * 16 - smallRound * 4;
-		int threshold = 0;
-		for (int i = 0; i < b.size; ++i)
+		if (a.size >= tuning().mulSimdMinDigits)
 		{
-			factor = _mm_set1_epi32(b.row[i]);
-			pa = reinterpret_cast<__m128i*>(a.row);
-			ptemp = reinterpret_cast<__m128i*>(temp.row + i);
-			for (int j = 0; j < bigRound; ++j)
-			{
-				loader1 = _mm_mullo_epi32(_mm_loadu_si128(pa), factor);
-				loader2 = _mm_mullo_epi32(_mm_loadu_si128(pa + 1), factor);
-				loader3 = _mm_mullo_epi32(_mm_loadu_si128(pa + 2), factor);
-				loader4 = _mm_mullo_epi32(_mm_loadu_si128(pa + 3), factor);
-				loader1 = _mm_add_epi32(loader1, *ptemp);
-				loader2 = _mm_add_epi32(loader2, *(ptemp + 1));
-				loader3 = _mm_add_epi32(loader3, *(ptemp + 2));
-				loader4 = _mm_add_epi32(loader4, *(ptemp + 3));
-				_mm_storeu_si128(ptemp, loader1);
-				_mm_storeu_si128(ptemp + 1, loader2);
-				_mm_storeu_si128(ptemp + 2, loader3);
-				_mm_storeu_si128(ptemp + 3, loader4);
-				pa += 4;
-				ptemp += 4;
-				threshold += 16;
-				if (threshold > 1000000)
-				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
-					{
-						if (temp.row[i] >= 10)
-						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
-						}
-					}
-				}
-			}
-			for (int j = 0; j < smallRound; ++j)
+			__m128i loader1, loader2, loader3, loader4, factor;
+			__m128i *pa = reinterpret_cast<__m128i*>(a.row);
+			__m128i *ptemp = reinterpret_cast<__m128i*>(temp.row);
+			int vecCount = (a.size + 3) / 4;
+			int bigRound = vecCount / 4;
+			int smallRound = vecCount - bigRound * 4;
+			int threshold = 0;
+			for (int i = 0; i < b.size; ++i)
 			{
-				loader1 = _mm_mullo_epi32(_mm_loadu_si128(pa), factor);
-				loader1 = _mm_add_epi32(loader1, *ptemp);
-				_mm_storeu_si128(ptemp, loader1);
-				pa += 1;
-				ptemp += 1;
-				threshold += 4;
-				if (threshold > 1000000)
+				pa = reinterpret_cast<__m128i*>(a.row);
+				ptemp = reinterpret_cast<__m128i*>(temp.row + i);
+				factor = _mm_set1_epi32(b.row[i]);
+				for (int j = 0; j < bigRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm_mullo_epi32(_mm_load_si128(pa), factor);
+					loader2 = _mm_mullo_epi32(_mm_load_si128(pa + 1), factor);
+					loader3 = _mm_mullo_epi32(_mm_load_si128(pa + 2), factor);
+					loader4 = _mm_mullo_epi32(_mm_load_si128(pa + 3), factor);
+					loader1 = _mm_add_epi32(loader1, _mm_loadu_si128(ptemp));
+					loader2 = _mm_add_epi32(loader2, _mm_loadu_si128(ptemp + 1));
+					loader3 = _mm_add_epi32(loader3, _mm_loadu_si128(ptemp + 2));
+					loader4 = _mm_add_epi32(loader4, _mm_loadu_si128(ptemp + 3));
+					_mm_storeu_si128(ptemp, loader1);
+					_mm_storeu_si128(ptemp + 1, loader2);
+					_mm_storeu_si128(ptemp + 2, loader3);
+					_mm_storeu_si128(ptemp + 3, loader4);
+					pa += 4;
+					ptemp += 4;
+					threshold += 16;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, b.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
-			}
-			for (int j = a.size - rest; j < a.size; ++j)
-			{
-				temp.row[i + j] += a.row[j] * b.row[i];
-				threshold += 1;
-				if (threshold > 1000000)
+				for (int j = 0; j < smallRound; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					loader1 = _mm_mullo_epi32(_mm_load_si128(pa), factor);
+					loader1 = _mm_add_epi32(loader1, _mm_loadu_si128(ptemp));
+					_mm_storeu_si128(ptemp, loader1);
+					pa += 1;
+					ptemp += 1;
+					threshold += 4;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, b.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
 			}
 		}
-#else
-		int threshold = 0;
-		for (int i = 0; i < b.size; ++i)
+		else
+#endif
 		{
-			for (int j = 0; j < a.size; ++j)
+			int threshold = 0;
+			for (int i = 0; i < b.size; ++i)
 			{
-				temp.row[i + j] += a.row[j] * b.row[i];
-				threshold += 1;
-				if (threshold > 1000000)
+				for (int j = 0; j < a.size; ++j)
 				{
-					threshold = 0;
-					for (int i = 0; i < temp.capacity; ++i)
+					temp.row[i + j] += a.row[j] * b.row[i];
+					threshold += 1;
+					if (threshold > carrySweep)
 					{
-						if (temp.row[i] >= 10)
+						threshold = 0;
+						__bigint_checkpoint(i, b.size);
+						BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+						for (int i = 0; i < temp.capacity; ++i)
 						{
-							temp.row[i + 1] += temp.row[i] / 10;
-							temp.row[i] %= 10;
+							if (temp.row[i] >= 10)
+							{
+								temp.row[i + 1] += temp.row[i] / 10;
+								temp.row[i] %= 10;
+							}
 						}
 					}
 				}
 			}
 		}
-#endif
 	}
-	for (int i = 0; i < temp.capacity; ++i)
 	{
-		if (temp.row[i] >= 10)
+		BIGINT_STAT_SCOPE(__STAT_CARRY_SWEEP, temp.capacity);
+		for (int i = 0; i < temp.capacity; ++i)
 		{
-			temp.row[i + 1] += temp.row[i] / 10;
-			temp.row[i] %= 10;
+			if (temp.row[i] >= 10)
+			{
+				temp.row[i + 1] += temp.row[i] / 10;
+				temp.row[i] %= 10;
+			}
 		}
 	}
 	temp.size = 0;
@@ -957,12 +1510,14 @@ Bigint Bigint::operator*(const Bigint &x)
 
 Bigint Bigint::operator%(const Bigint &x)
 {
+	BIGINT_STAT_SCOPE(__STAT_MODULO, size);
 	Bigint result = *this;
-	Bigint temp = x, two;
-	two.load("2");
+	Bigint temp = x;
+	const Bigint &two = constant(2);
 	std::stack<Bigint> sequence;
 	for (;;)
 	{
+		__bigint_checkpoint(0, 0);
 		if (!(*this < temp))
 		{
 			sequence.push(temp);
@@ -971,8 +1526,10 @@ Bigint Bigint::operator%(const Bigint &x)
 		else
 			break;
 	}
+	long long steps = sequence.size();
 	while (!sequence.empty())
 	{
+		__bigint_checkpoint(steps - (long long)sequence.size(), steps);
 		if (!(result < sequence.top()))
 			result = result - sequence.top();
 		sequence.pop();
@@ -982,38 +1539,88 @@ Bigint Bigint::operator%(const Bigint &x)
 
 Bigint& Bigint::operator=(Bigint &&x)
 {
-	delete[] row;
+	hashValue.store(x.hashValue.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	x.hashValue.store(0, std::memory_order_relaxed);
+	int *old = row;
+	int oldSize = size;
+	int oldCapacity = capacity;
 	row = x.row;
 	size = x.size;
 	capacity = x.capacity;
 	isNegative = x.isNegative;
-	x.row = new int[1];
-	return *this;
-}
-
-Bigint& Bigint::operator=(const Bigint &x)
-{
-	if (capacity < x.size + 1)
+	if (__row_owners(old).load() == 1)
 	{
-		delete[] row;
-		row = new int[x.size + 1];
-		memcpy(row, x.row, sizeof(int) * x.size);
-		row[x.size - 1] = 0;
-		size = x.size;
-		capacity = size + 1;
-		isNegative = x.isNegative;
+		memset(old, 0, sizeof(int) * oldSize);
+		x.row = old;
+		x.capacity = oldCapacity;
 	}
 	else
 	{
-		memset(row, 0, sizeof(int) * capacity);
-		memcpy(row, x.row, sizeof(int) * x.size);
-		size = x.size;
-		isNegative = x.isNegative;
+		__free_row(old);
+		x.capacity = __ROW_PAD;
+		x.row = __allocate_row(x.capacity);
+		memset(x.row, 0, sizeof(int) * x.capacity);
 	}
+	x.size = 1;
+	x.isNegative = false;
 	return *this;
 }
 
-bool Bigint::operator<(const Bigint &x)
+Bigint& Bigint::operator=(const Bigint &x)
+{
+	if (this == &x)
+		return *this;
+#if defined COW
+	int *old = row;
+	row = __share_row(x.row);
+	__free_row(old);
+	size = x.size;
+	capacity = x.capacity;
+	isNegative = x.isNegative;
+#else
+	__assign_digits(x);
+#endif
+	hashValue.store(x.hashValue.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	return *this;
+}
+
+// always copies into a row of our own, keeping the capacity when it is enough
+void Bigint::__assign_digits(const Bigint &x)
+{
+	__prepare_row(x.size + 1);
+	memcpy(row, x.row, sizeof(int) * x.size);
+	if (size > x.size)
+		memset(row + x.size, 0, sizeof(int) * (size - x.size));
+	size = x.size;
+	isNegative = x.isNegative;
+	hashValue.store(0, std::memory_order_relaxed);
+}
+
+// moves the digits into a private row of exactly needed ints (rounded up to the padding)
+void Bigint::__reallocate_row(int needed)
+{
+	int *fresh = __allocate_row(needed);
+	memcpy(fresh, row, sizeof(int) * size);
+	memset(fresh + size, 0, sizeof(int) * (needed - size));
+	__free_row(row);
+	row = fresh;
+	capacity = needed;
+}
+
+void Bigint::reserve(int digits)
+{
+	if (capacity < digits + 1)
+		__reallocate_row(digits + 1);
+}
+
+void Bigint::shrinkToFit()
+{
+	int needed = (size + 1 + __ROW_PAD - 1) / __ROW_PAD * __ROW_PAD;
+	if (capacity > needed)
+		__reallocate_row(needed);
+}
+
+bool Bigint::operator<(const Bigint &x) const
 {
 	if (isNegative)
 	{
@@ -1027,14 +1634,8 @@ bool Bigint::operator<(const Bigint &x)
 				return true;
 			else
 			{
-				for (int i = size - 1; i >= 0; --i)
-				{
-					if (row[i] > x.row[i])
-						return true;
-					else if (row[i] < x.row[i])
-						return false;
-				}
-				return false;
+				int i = __highest_difference(x);
+				return i >= 0 && row[i] > x.row[i];
 			}
 		}
 	}
@@ -1050,27 +1651,113 @@ bool Bigint::operator<(const Bigint &x)
 				return false;
 			else
 			{
-				for (int i = size - 1; i >= 0; --i)
-				{
-					if (row[i] < x.row[i])
-						return true;
-					else if (row[i] > x.row[i])
-						return false;
-				}
-				return false;
+				int i = __highest_difference(x);
+				return i >= 0 && row[i] < x.row[i];
 			}
 		}
 	}
 }
 
-bool Bigint::operator==(const Bigint &x)
+bool Bigint::operator==(const Bigint &x) const
 {
-	if (size != x.size)
+	if (size != x.size || isNegative != x.isNegative)
 		return false;
-	for (int i = 0; i < size; ++i)
+	return __highest_difference(x) < 0;
+}
+
+int Bigint::compare(const Bigint &x) const
+{
+	if (isNegative != x.isNegative)
+		return isNegative ? -1 : 1;
+	int sign = isNegative ? -1 : 1;
+	if (size != x.size)
+		return size < x.size ? -sign : sign;
+	int i = __highest_difference(x);
+	if (i < 0)
+		return 0;
+	return row[i] < x.row[i] ? -sign : sign;
+}
+
+// index of the highest digit where two numbers of the same size differ, -1 if none;
+// the zero padding lets whole vectors be compared
+int Bigint::__highest_difference(const Bigint &x) const
+{
+#if defined AVX
+	for (int v = (size + 7) / 8 - 1; v >= 0; --v)
+	{
+		__m256i equal = _mm256_cmpeq_epi32(_mm256_load_si256(reinterpret_cast<__m256i*>(row) + v),
+			_mm256_load_si256(reinterpret_cast<__m256i*>(x.row) + v));
+		if (_mm256_movemask_epi8(equal) != -1)
+		{
+			for (int i = v * 8 + 7; i >= v * 8; --i)
+				if (row[i] != x.row[i])
+					return i;
+		}
+	}
+	return -1;
+#elif defined SSE
+	for (int v = (size + 3) / 4 - 1; v >= 0; --v)
+	{
+		__m128i equal = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<__m128i*>(row) + v),
+			_mm_load_si128(reinterpret_cast<__m128i*>(x.row) + v));
+		if (_mm_movemask_epi8(equal) != 0xFFFF)
+		{
+			for (int i = v * 4 + 3; i >= v * 4; --i)
+				if (row[i] != x.row[i])
+					return i;
+		}
+	}
+	return -1;
+#else
+	for (int i = size - 1; i >= 0; --i)
 		if (row[i] != x.row[i])
-			return false;
-	return true;
+			return i;
+	return -1;
+#endif
+}
+
+// eight 32-bit multiply-xor lanes over the digits, folded into 64 bits at the end;
+// every instruction set computes the same value
+size_t Bigint::hash() const
+{
+	size_t cached = hashValue.load(std::memory_order_relaxed);
+	if (cached != 0)
+		return cached;
+	const unsigned int prime = 0x9E3779B1u;
+	unsigned int lane[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	int vectors = (size + 7) / 8;
+#if defined AVX
+	__m256i acc = _mm256_loadu_si256(reinterpret_cast<__m256i*>(lane));
+	__m256i factor = _mm256_set1_epi32((int)prime);
+	for (int v = 0; v < vectors; ++v)
+		acc = _mm256_mullo_epi32(_mm256_xor_si256(acc, _mm256_load_si256(reinterpret_cast<__m256i*>(row) + v)), factor);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lane), acc);
+#elif defined SSE
+	__m128i low = _mm_loadu_si128(reinterpret_cast<__m128i*>(lane));
+	__m128i high = _mm_loadu_si128(reinterpret_cast<__m128i*>(lane + 4));
+	__m128i factor = _mm_set1_epi32((int)prime);
+	for (int v = 0; v < vectors; ++v)
+	{
+		low = _mm_mullo_epi32(_mm_xor_si128(low, _mm_load_si128(reinterpret_cast<__m128i*>(row) + 2 * v)), factor);
+		high = _mm_mullo_epi32(_mm_xor_si128(high, _mm_load_si128(reinterpret_cast<__m128i*>(row) + 2 * v + 1)), factor);
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lane), low);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lane + 4), high);
+#else
+	for (int v = 0; v < vectors; ++v)
+		for (int j = 0; j < 8; ++j)
+			lane[j] = (lane[j] ^ (unsigned int)row[v * 8 + j]) * prime;
+#endif
+	unsigned long long h = (unsigned long long)size * 2 + (isNegative ? 1 : 0);
+	for (int j = 0; j < 8; ++j)
+		h = (h ^ lane[j]) * 0x100000001B3ULL;
+	h ^= h >> 31;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 29;
+	if (h == 0)
+		h = 1;
+	hashValue.store((size_t)h, std::memory_order_relaxed);
+	return (size_t)h;
 }
 
 void Bigint::print()
@@ -1084,16 +1771,15 @@ void Bigint::print()
 
 void Bigint::load(const char* input_)
 {
+	hashValue.store(0, std::memory_order_relaxed);
 	int length = strlen(input_);
+	BIGINT_STAT_SCOPE(__STAT_LOAD, length);
+	// only the digits of the old value beyond the new one need clearing
 	if (input_[0] == '-')
 	{
-		if (length - 1 >= capacity)
-		{
-			delete[] row;
-			row = new int[length];
-			capacity = length;
-		}
-		memset(row, 0, sizeof(int) * capacity);
+		__prepare_row(length);
+		if (size > length - 1)
+			memset(row + length - 1, 0, sizeof(int) * (size - length + 1));
 		for (int i = length - 1; i >= 1; --i)
 			row[length - 1 - i] = input_[i] - '0';
 		size = length - 1;
@@ -1101,13 +1787,9 @@ void Bigint::load(const char* input_)
 	}
 	else
 	{
-		if (length >= capacity)
-		{
-			delete[] row;
-			row = new int[length + 1];
-			capacity = length + 1;
-		}
-		memset(row, 0, sizeof(int) * capacity);
+		__prepare_row(length + 1);
+		if (size > length)
+			memset(row + length, 0, sizeof(int) * (size - length));
 		for (int i = length - 1; i >= 0; --i)
 			row[length - 1 - i] = input_[i] - '0';
 		size = length;
@@ -1118,6 +1800,7 @@ void Bigint::load(const char* input_)
 
 void Bigint::extract(char *target_)
 {
+	BIGINT_STAT_SCOPE(__STAT_EXTRACT, size);
 	if (isNegative)
 	{
 		target_[0] = '-';
@@ -1135,6 +1818,8 @@ void Bigint::extract(char *target_)
 
 void Bigint::cutHalf()
 {
+	hashValue.store(0, std::memory_order_relaxed);
+	__detach();
 	for (int i = size - 1; i >= 1; --i)
 	{
 		if (row[i] % 2)
@@ -1145,3 +1830,1762 @@ void Bigint::cutHalf()
 	if (row[size - 1] == 0 && size != 1)
 		--size;
 }
+
+Bigint Bigint::__from_unsigned(unsigned long long x)
+{
+	Bigint temp(24);
+	temp.size = 0;
+	do
+	{
+		temp.row[temp.size++] = int(x % 10);
+		x /= 10;
+	} while (x != 0);
+	return temp;
+}
+
+// subtrees above parallelDepth levels run on their own threads
+Bigint Bigint::__product_tree(const Bigint *first, const Bigint *last, int parallelDepth)
+{
+	if (last - first == 1)
+		return *first;
+	if (last - first == 2)
+	{
+		Bigint temp = *first;
+		temp = temp * first[1];
+		__bigint_step();
+		return temp;
+	}
+	__bigint_checkpoint(0, 0);
+	const Bigint *middle = first + (last - first) / 2;
+	if (parallelDepth > 0)
+	{
+		// the job of this thread goes along to the other one
+		__bigint_job_slot slot = __bigint_current_job();
+		std::future<Bigint> left = std::async(std::launch::async, [slot, first, middle, parallelDepth]
+		{
+			__bigint_current_job() = slot;
+			return __product_tree(first, middle, parallelDepth - 1);
+		});
+		Bigint right = __product_tree(middle, last, parallelDepth - 1);
+		Bigint temp = left.get();
+		temp = temp * right;
+		__bigint_step();
+		return temp;
+	}
+	Bigint temp = __product_tree(first, middle, 0);
+	temp = temp * __product_tree(middle, last, 0);
+	__bigint_step();
+	return temp;
+}
+
+// multiplies small factors together in machine words first, then the words in a tree
+Bigint Bigint::__product_of_factors(std::vector<unsigned long long> &factors, bool parallel)
+{
+	std::vector<Bigint> leaves;
+	unsigned long long word = 1;
+	for (size_t i = 0; i < factors.size(); ++i)
+	{
+		if (word > 1000000000000000000ULL / factors[i])
+		{
+			leaves.push_back(__from_unsigned(word));
+			word = 1;
+		}
+		word *= factors[i];
+	}
+	leaves.push_back(__from_unsigned(word));
+	return __product_tree(leaves.data(), leaves.data() + leaves.size(), parallel ? 3 : 0);
+}
+
+std::vector<int> Bigint::__primes_up_to(int n)
+{
+	std::vector<int> primes;
+	std::vector<bool> composite(n + 1, false);
+	for (int i = 2; i <= n; ++i)
+	{
+		if (composite[i])
+			continue;
+		primes.push_back(i);
+		for (long long j = (long long)i * i; j <= n; j += i)
+			composite[j] = true;
+	}
+	return primes;
+}
+
+// n! / ((n / 2)!)^2, built from the primes that divide it
+Bigint Bigint::__swing(int n, const std::vector<int> &primes, bool parallel)
+{
+	std::vector<unsigned long long> factors;
+	for (size_t i = 0; i < primes.size() && primes[i] <= n; ++i)
+	{
+		int p = primes[i];
+		unsigned long long power = 1;
+		for (int q = n / p; q > 0; q /= p)
+			if (q & 1)
+				power *= p;
+		if (power > 1)
+			factors.push_back(power);
+	}
+	return __product_of_factors(factors, parallel);
+}
+
+Bigint Bigint::__factorial(int n, const std::vector<int> &primes, bool parallel)
+{
+	if (n < 2)
+		return __from_unsigned(1);
+	Bigint half = __factorial(n / 2, primes, parallel);
+	Bigint square = half * half;
+	return square * __swing(n, primes, parallel);
+}
+
+Bigint Bigint::product(const Bigint *first, const Bigint *last, bool parallel)
+{
+	if (first == last)
+		return __from_unsigned(1);
+	return __product_tree(first, last, parallel ? 3 : 0);
+}
+
+Bigint Bigint::factorial(int n, bool parallel)
+{
+	// 0! and 1! are 1, and so is every negative n, without building a sieve
+	if (n < 2)
+		return __from_unsigned(1);
+	return __factorial(n, __primes_up_to(n), parallel);
+}
+
+std::future<Bigint> Bigint::multiplyAsync(const Bigint &a, const Bigint &b, std::shared_ptr<BigintJob> job, BigintExecutor &executor)
+{
+	return executor.submit(job, [a, b]
+	{
+		Bigint temp = a;
+		return temp * b;
+	}, 0);
+}
+
+std::future<Bigint> Bigint::moduloAsync(const Bigint &a, const Bigint &b, std::shared_ptr<BigintJob> job, BigintExecutor &executor)
+{
+	return executor.submit(job, [a, b]
+	{
+		Bigint temp = a;
+		return temp % b;
+	}, 0);
+}
+
+std::future<Bigint> Bigint::productAsync(const Bigint *first, const Bigint *last, bool parallel, std::shared_ptr<BigintJob> job, BigintExecutor &executor)
+{
+	std::vector<Bigint> factors(first, last);
+	long long steps = factors.size() > 1 ? (long long)factors.size() - 1 : -1;
+	return executor.submit(job, [factors, parallel]
+	{
+		return product(factors.data(), factors.data() + factors.size(), parallel);
+	}, steps);
+}
+
+std::future<Bigint> Bigint::factorialAsync(int n, bool parallel, std::shared_ptr<BigintJob> job, BigintExecutor &executor)
+{
+	return executor.submit(job, [n, parallel]
+	{
+		return factorial(n, parallel);
+	}, -1);
+}
+
+Bigint Bigint::binomial(int n, int k, bool parallel)
+{
+	if (k < 0 || k > n)
+		return Bigint();
+	std::vector<int> primes = __primes_up_to(n);
+	std::vector<unsigned long long> factors;
+	for (size_t i = 0; i < primes.size(); ++i)
+	{
+		// Legendre: the exponent of p is the number of borrows in n - k
+		long long p = primes[i];
+		unsigned long long power = 1;
+		for (long long q = p; q <= n; q *= p)
+			if (n / q - k / q - (n - k) / q > 0)
+				power *= p;
+		if (power > 1)
+			factors.push_back(power);
+	}
+	return __product_of_factors(factors, parallel);
+}
+
+struct Bigint::__constant_table
+{
+	static const int SMALL_LOW = -16;
+	static const int SMALL_HIGH = 256;
+	static const int MAX_EXPONENT = 256;
+	std::vector<Bigint> small;
+	std::vector<Bigint> twos;
+	std::vector<Bigint> tens;
+	__constant_table()
+	{
+		for (int i = SMALL_LOW; i <= SMALL_HIGH; ++i)
+			small.push_back(Bigint::small(i));
+		twos.push_back(Bigint::small(1));
+		for (int i = 1; i <= MAX_EXPONENT; ++i)
+		{
+			Bigint last = twos.back();
+			twos.push_back(last + twos.back());
+		}
+		for (int i = 0; i <= MAX_EXPONENT; ++i)
+		{
+			Bigint temp(i + 1);
+			temp.row[i] = 1;
+			temp.size = i + 1;
+			tens.push_back(temp);
+		}
+	}
+};
+
+// built once, on first use (thread-safe since C++11)
+const Bigint::__constant_table & Bigint::__constants()
+{
+	static const __constant_table table;
+	return table;
+}
+
+Bigint Bigint::small(long long x)
+{
+	Bigint temp = __from_unsigned(x < 0 ? 0ULL - (unsigned long long)x : (unsigned long long)x);
+	temp.isNegative = x < 0;
+	return temp;
+}
+
+BigintExecutor & BigintExecutor::shared()
+{
+	// the constant tables are built first, so they are destroyed after the
+	// executor at exit and the operations it is still running can use them
+	Bigint::constant(0);
+	static BigintExecutor executor(std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1);
+	return executor;
+}
+
+const Bigint & Bigint::constant(int x)
+{
+	return __constants().small[x - __constant_table::SMALL_LOW];
+}
+
+const Bigint & Bigint::powerOfTwo(int k)
+{
+	return __constants().twos[k];
+}
+
+const Bigint & Bigint::powerOfTen(int k)
+{
+	return __constants().tens[k];
+}
+
+// One limb holds a number below base: 2^32 for the power-of-two radixes, so digits
+// are plain bit fields, otherwise the highest power of the radix fitting in 32 bits.
+// tens[j] is 10^(18 * 2^j) in limbs, powers[j] is base^(2^j) in decimal; both grow
+// on demand under the lock and are never shrunk.
+struct Bigint::__radix_table
+{
+	int radix;
+	int bits;
+	int digitsPerLimb;
+	unsigned long long base;
+	std::vector<std::vector<unsigned int> > tens;
+	std::vector<Bigint> powers;
+	std::mutex lock;
+	void init(int radix_)
+	{
+		radix = radix_;
+		bits = 0;
+		while ((1 << bits) < radix)
+			++bits;
+		if ((1 << bits) != radix)
+			bits = 0;
+		if (bits != 0)
+		{
+			base = 1ULL << 32;
+			digitsPerLimb = 32 / bits;
+		}
+		else
+		{
+			base = 1;
+			digitsPerLimb = 0;
+			while (base * radix <= (1ULL << 32))
+			{
+				base *= radix;
+				++digitsPerLimb;
+			}
+		}
+	}
+	// copies of the first levels entries of each table
+	void take(int tenLevels, int powerLevels, std::vector<std::vector<unsigned int> > &tensOut, std::vector<Bigint> &powersOut)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (tens.empty())
+		{
+			std::vector<unsigned int> first;
+			for (unsigned long long x = 1000000000000000000ULL; x != 0; x /= base)
+				first.push_back((unsigned int)(x % base));
+			tens.push_back(first);
+		}
+		while ((int)tens.size() < tenLevels)
+		{
+			std::vector<unsigned int> square;
+			Bigint::__limb_multiply(tens.back(), tens.back(), square, base);
+			tens.push_back(square);
+		}
+		if (powers.empty())
+			powers.push_back(Bigint::__from_unsigned(base));
+		while ((int)powers.size() < powerLevels)
+		{
+			Bigint last = powers.back();
+			powers.push_back(last * powers.back());
+		}
+		tensOut.assign(tens.begin(), tens.begin() + tenLevels);
+		powersOut.assign(powers.begin(), powers.begin() + powerLevels);
+	}
+};
+
+Bigint::__radix_table & Bigint::__radix_tables(int radix)
+{
+	static __radix_table tables[37];
+	static std::once_flag ready[37];
+	std::call_once(ready[radix], [radix] { tables[radix].init(radix); });
+	return tables[radix];
+}
+
+// schoolbook product of little-endian limbs below base (at most 2^32, so no step overflows)
+void Bigint::__limb_multiply(const std::vector<unsigned int> &a, const std::vector<unsigned int> &b,
+	std::vector<unsigned int> &result, unsigned long long base)
+{
+	result.assign(a.size() + b.size(), 0);
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		unsigned long long carry = 0;
+		for (size_t j = 0; j < b.size(); ++j)
+		{
+			unsigned long long cur = result[i + j] + (unsigned long long)a[i] * b[j] + carry;
+			result[i + j] = (unsigned int)(cur % base);
+			carry = cur / base;
+		}
+		for (size_t k = i + b.size(); carry != 0; ++k)
+		{
+			unsigned long long cur = result[k] + carry;
+			result[k] = (unsigned int)(cur % base);
+			carry = cur / base;
+		}
+	}
+	while (result.size() > 1 && result.back() == 0)
+		result.pop_back();
+}
+
+// row[low, low + count) as limbs: high half * 10^(18 * 2^j) + low half
+void Bigint::__digits_to_limbs(int low, int count, const std::vector<std::vector<unsigned int> > &tens,
+	unsigned long long base, std::vector<unsigned int> &result) const
+{
+	if (count <= 18)
+	{
+		unsigned long long x = 0;
+		for (int i = low + count - 1; i >= low; --i)
+			x = x * 10 + row[i];
+		result.clear();
+		do
+		{
+			result.push_back((unsigned int)(x % base));
+			x /= base;
+		} while (x != 0);
+		return;
+	}
+	int level = 0;
+	while (18 << (level + 1) < count)
+		++level;
+	int half = 18 << level;
+	std::vector<unsigned int> high, rest;
+	__digits_to_limbs(low + half, count - half, tens, base, high);
+	__digits_to_limbs(low, half, tens, base, rest);
+	__limb_multiply(high, tens[level], result, base);
+	if (result.size() < rest.size())
+		result.resize(rest.size(), 0);
+	unsigned long long carry = 0;
+	for (size_t i = 0; i < result.size() && (i < rest.size() || carry != 0); ++i)
+	{
+		unsigned long long cur = result[i] + carry + (i < rest.size() ? rest[i] : 0);
+		result[i] = (unsigned int)(cur % base);
+		carry = cur / base;
+	}
+	if (carry != 0)
+		result.push_back((unsigned int)carry);
+}
+
+// limbs[0, count) in decimal: high half * base^(2^j) + low half
+Bigint Bigint::__limbs_to_digits(const unsigned int *limbs, int count, const std::vector<Bigint> &powers)
+{
+	while (count > 1 && limbs[count - 1] == 0)
+		--count;
+	if (count == 1)
+		return __from_unsigned(limbs[0]);
+	int level = 0;
+	while (2 << level < count)
+		++level;
+	int half = 1 << level;
+	return __limbs_to_digits(limbs + half, count - half, powers) * powers[level]
+		+ __limbs_to_digits(limbs, half, powers);
+}
+
+std::string Bigint::toString(int radix) const
+{
+	std::string text;
+	if (radix < 2 || radix > 36)
+		throw std::invalid_argument("Bigint::toString: radix must be from 2 to 36");
+	if (radix == 10)
+	{
+		text.resize(size + 1);
+		const_cast<Bigint*>(this)->extract(&text[0]);
+		text.resize(strlen(text.c_str()));
+		return text;
+	}
+	__radix_table &table = __radix_tables(radix);
+	int tenLevels = 1;
+	while (18 << tenLevels < size)
+		++tenLevels;
+	std::vector<std::vector<unsigned int> > tens;
+	std::vector<Bigint> powers;
+	table.take(tenLevels, 0, tens, powers);
+	std::vector<unsigned int> limbs;
+	__digits_to_limbs(0, size, tens, table.base, limbs);
+
+	static const char alphabet[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	if (table.bits != 0)
+	{
+		// bit slicing, a digit may straddle two limbs
+		int total = int((limbs.size() * 32 + table.bits - 1) / table.bits);
+		unsigned int mask = (1u << table.bits) - 1;
+		for (int d = 0; d < total; ++d)
+		{
+			long long bit = (long long)d * table.bits;
+			size_t word = size_t(bit / 32);
+			int shift = int(bit % 32);
+			unsigned long long pair = limbs[word];
+			if (word + 1 < limbs.size())
+				pair |= (unsigned long long)limbs[word + 1] << 32;
+			text.push_back(alphabet[(pair >> shift) & mask]);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < limbs.size(); ++i)
+		{
+			unsigned int limb = limbs[i];
+			for (int d = 0; d < table.digitsPerLimb; ++d)
+			{
+				text.push_back(alphabet[limb % radix]);
+				limb /= radix;
+			}
+		}
+	}
+	while (text.size() > 1 && text.back() == '0')
+		text.pop_back();
+	if (isNegative)
+		text.push_back('-');
+	return std::string(text.rbegin(), text.rend());
+}
+
+Bigint Bigint::fromString(const char *input_, int radix)
+{
+	Bigint temp;
+	if (radix < 2 || radix > 36)
+		throw std::invalid_argument("Bigint::fromString: radix must be from 2 to 36");
+	if (radix == 10)
+	{
+		temp.load(input_);
+		return temp;
+	}
+	bool negative = input_[0] == '-';
+	if (negative)
+		++input_;
+	int length = strlen(input_);
+	__radix_table &table = __radix_tables(radix);
+	int perLimb = table.bits != 0 ? 32 : table.digitsPerLimb;
+	int stride = table.bits != 0 ? table.bits : 1;
+	std::vector<unsigned int> limbs((size_t(length) * stride + perLimb - 1) / perLimb + 1, 0);
+	for (int d = 0; d < length; ++d)
+	{
+		char c = input_[length - 1 - d];
+		unsigned int value = c >= 'a' ? c - 'a' + 10 : c >= 'A' ? c - 'A' + 10 : c - '0';
+		if (table.bits != 0)
+		{
+			// bit slicing, a digit may straddle two limbs
+			long long bit = (long long)d * table.bits;
+			size_t word = size_t(bit / 32);
+			int shift = int(bit % 32);
+			unsigned long long pair = (unsigned long long)value << shift;
+			limbs[word] |= (unsigned int)pair;
+			limbs[word + 1] |= (unsigned int)(pair >> 32);
+		}
+	}
+	if (table.bits == 0)
+	{
+		for (size_t i = 0; i < limbs.size(); ++i)
+		{
+			unsigned long long limb = 0;
+			int top = int(i) * perLimb + perLimb;
+			for (int d = (top < length ? top : length) - 1; d >= int(i) * perLimb; --d)
+			{
+				char c = input_[length - 1 - d];
+				limb = limb * radix + (c >= 'a' ? c - 'a' + 10 : c >= 'A' ? c - 'A' + 10 : c - '0');
+			}
+			limbs[i] = (unsigned int)limb;
+		}
+	}
+	int count = int(limbs.size());
+	int powerLevels = 1;
+	while (1 << powerLevels < count)
+		++powerLevels;
+	std::vector<std::vector<unsigned int> > tens;
+	std::vector<Bigint> powers;
+	table.take(0, powerLevels, tens, powers);
+	temp = __limbs_to_digits(limbs.data(), count, powers);
+	temp.isNegative = negative;
+	temp.__eliminate_double_zero();
+	return temp;
+}
+
+BigintStats Bigint::statistics()
+{
+	BigintStats snapshot;
+	memset(&snapshot, 0, sizeof(snapshot));
+#if defined STATS
+	BigintStats::Counter *target[__STAT_COUNT] = { &snapshot.add, &snapshot.subtract, &snapshot.multiplySimd,
+		&snapshot.multiplyPlain, &snapshot.carrySweep, &snapshot.modulo, &snapshot.load, &snapshot.extract };
+	__bigint_stat_table &table = __bigint_stats();
+	for (int i = 0; i < __STAT_COUNT; ++i)
+	{
+		target[i]->calls = table.counter[i].calls;
+		target[i]->limbs = table.counter[i].limbs;
+		target[i]->nanoseconds = table.counter[i].nanoseconds;
+	}
+	snapshot.allocations = table.allocations;
+	snapshot.allocatedBytes = table.allocatedBytes;
+#endif
+	return snapshot;
+}
+
+void Bigint::resetStatistics()
+{
+#if defined STATS
+	__bigint_stat_table &table = __bigint_stats();
+	for (int i = 0; i < __STAT_COUNT; ++i)
+	{
+		table.counter[i].calls = 0;
+		table.counter[i].limbs = 0;
+		table.counter[i].nanoseconds = 0;
+	}
+	table.allocations = 0;
+	table.allocatedBytes = 0;
+#endif
+}
+
+class BigintBatch
+{
+	// digit d of number i lives in digit[d * stride + i]
+	int count;
+	int width;
+	int stride;
+	int *digit;
+	int *sign;
+	void __allocate()
+	{
+		stride = (count + Bigint::__ROW_PAD - 1) / Bigint::__ROW_PAD * Bigint::__ROW_PAD;
+		int cells = width * stride;
+		int lanes = stride;
+		digit = Bigint::__allocate_row(cells);
+		sign = Bigint::__allocate_row(lanes);
+	}
+	void __magnitude_order(const BigintBatch &a, const BigintBatch &b, int *less, int *greater);
+	void __signed_add(const BigintBatch &a, const BigintBatch &b, bool negateB);
+
+public:
+	BigintBatch(int count_, int width_) : count(count_), width(width_)
+	{
+		__allocate();
+		memset(digit, 0, sizeof(int) * width * stride);
+		memset(sign, 0, sizeof(int) * stride);
+	}
+	BigintBatch(const BigintBatch &x) : count(x.count), width(x.width)
+	{
+		__allocate();
+		memcpy(digit, x.digit, sizeof(int) * width * stride);
+		memcpy(sign, x.sign, sizeof(int) * stride);
+	}
+	BigintBatch& operator=(const BigintBatch &x) = delete;
+	~BigintBatch()
+	{
+		Bigint::__free_row(digit);
+		Bigint::__free_row(sign);
+	}
+	int getCount()
+	{
+		return count;
+	}
+	int getWidth()
+	{
+		return width;
+	}
+	void set(int index, const Bigint &x);
+	Bigint get(int index);
+	void add(const BigintBatch &a, const BigintBatch &b);
+	void subtract(const BigintBatch &a, const BigintBatch &b);
+	void multiply(const BigintBatch &a, const BigintBatch &b);
+	void compare(const BigintBatch &b, int *result);
+};
+
+void BigintBatch::set(int index, const Bigint &x)
+{
+	for (int d = 0; d < width; ++d)
+		digit[d * stride + index] = d < x.size ? x.row[d] : 0;
+	sign[index] = x.isNegative ? 1 : 0;
+}
+
+Bigint BigintBatch::get(int index)
+{
+	Bigint temp(width + 1);
+	for (int d = 0; d < width; ++d)
+	{
+		temp.row[d] = digit[d * stride + index];
+		if (temp.row[d] != 0)
+			temp.size = d + 1;
+	}
+	temp.isNegative = sign[index] != 0;
+	temp.__eliminate_double_zero();
+	return temp;
+}
+
+// less[i] / greater[i] become -1 when |a[i]| < |b[i]| / |a[i]| > |b[i]|, otherwise 0
+void BigintBatch::__magnitude_order(const BigintBatch &a, const BigintBatch &b, int *less, int *greater)
+{
+	int top = a.width > b.width ? a.width : b.width;
+	memset(less, 0, sizeof(int) * stride);
+	memset(greater, 0, sizeof(int) * stride);
+#if defined AVX
+	__m256i zero = _mm256_setzero_si256();
+	for (int d = top - 1; d >= 0; --d)
+	{
+		for (int i = 0; i < stride; i += 8)
+		{
+			__m256i x = d < a.width ? _mm256_load_si256(reinterpret_cast<__m256i*>(a.digit + d * stride + i)) : zero;
+			__m256i y = d < b.width ? _mm256_load_si256(reinterpret_cast<__m256i*>(b.digit + d * stride + i)) : zero;
+			__m256i lt = _mm256_load_si256(reinterpret_cast<__m256i*>(less + i));
+			__m256i gt = _mm256_load_si256(reinterpret_cast<__m256i*>(greater + i));
+			__m256i decided = _mm256_or_si256(lt, gt);
+			lt = _mm256_or_si256(lt, _mm256_andnot_si256(decided, _mm256_cmpgt_epi32(y, x)));
+			gt = _mm256_or_si256(gt, _mm256_andnot_si256(decided, _mm256_cmpgt_epi32(x, y)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(less + i), lt);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(greater + i), gt);
+		}
+	}
+#elif defined SSE
+	__m128i zero = _mm_setzero_si128();
+	for (int d = top - 1; d >= 0; --d)
+	{
+		for (int i = 0; i < stride; i += 4)
+		{
+			__m128i x = d < a.width ? _mm_load_si128(reinterpret_cast<__m128i*>(a.digit + d * stride + i)) : zero;
+			__m128i y = d < b.width ? _mm_load_si128(reinterpret_cast<__m128i*>(b.digit + d * stride + i)) : zero;
+			__m128i lt = _mm_load_si128(reinterpret_cast<__m128i*>(less + i));
+			__m128i gt = _mm_load_si128(reinterpret_cast<__m128i*>(greater + i));
+			__m128i decided = _mm_or_si128(lt, gt);
+			lt = _mm_or_si128(lt, _mm_andnot_si128(decided, _mm_cmpgt_epi32(y, x)));
+			gt = _mm_or_si128(gt, _mm_andnot_si128(decided, _mm_cmpgt_epi32(x, y)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(less + i), lt);
+			_mm_store_si128(reinterpret_cast<__m128i*>(greater + i), gt);
+		}
+	}
+#else
+	for (int d = top - 1; d >= 0; --d)
+	{
+		for (int i = 0; i < stride; ++i)
+		{
+			int x = d < a.width ? a.digit[d * stride + i] : 0;
+			int y = d < b.width ? b.digit[d * stride + i] : 0;
+			if (less[i] == 0 && greater[i] == 0)
+			{
+				if (x < y)
+					less[i] = -1;
+				else if (x > y)
+					greater[i] = -1;
+			}
+		}
+	}
+#endif
+}
+
+// one pass for both "+" and "-": every lane computes |big| +- |small| with a carry in [-1, 1]
+void BigintBatch::__signed_add(const BigintBatch &a, const BigintBatch &b, bool negateB)
+{
+	int lanes = stride;
+	int *swap = Bigint::__allocate_row(lanes);
+	int *greater = Bigint::__allocate_row(lanes);
+	int *carry = Bigint::__allocate_row(lanes);
+	int *nonZero = Bigint::__allocate_row(lanes);
+	int *signB = Bigint::__allocate_row(lanes);
+	__magnitude_order(a, b, swap, greater);
+	for (int i = 0; i < stride; ++i)
+	{
+		signB[i] = negateB ? b.sign[i] ^ 1 : b.sign[i];
+		// "factor" of b: -1 when signs differ
+		greater[i] = a.sign[i] != signB[i] ? -1 : 1;
+		// only swap operands when the signs differ and |a| < |b|
+		if (greater[i] == 1)
+			swap[i] = 0;
+	}
+	memset(carry, 0, sizeof(int) * stride);
+	memset(nonZero, 0, sizeof(int) * stride);
+#if defined AVX
+	__m256i zero = _mm256_setzero_si256();
+	__m256i nine = _mm256_set1_epi32(9);
+	__m256i ten = _mm256_set1_epi32(10);
+	for (int d = 0; d < width; ++d)
+	{
+		for (int i = 0; i < stride; i += 8)
+		{
+			__m256i x = d < a.width ? _mm256_load_si256(reinterpret_cast<__m256i*>(a.digit + d * stride + i)) : zero;
+			__m256i y = d < b.width ? _mm256_load_si256(reinterpret_cast<__m256i*>(b.digit + d * stride + i)) : zero;
+			__m256i exchange = _mm256_load_si256(reinterpret_cast<__m256i*>(swap + i));
+			__m256i factor = _mm256_load_si256(reinterpret_cast<__m256i*>(greater + i));
+			__m256i c = _mm256_load_si256(reinterpret_cast<__m256i*>(carry + i));
+			__m256i big = _mm256_blendv_epi8(x, y, exchange);
+			__m256i small = _mm256_blendv_epi8(y, x, exchange);
+			__m256i sum = _mm256_add_epi32(_mm256_add_epi32(big, _mm256_sign_epi32(small, factor)), c);
+			__m256i over = _mm256_cmpgt_epi32(sum, nine);
+			__m256i under = _mm256_cmpgt_epi32(zero, sum);
+			sum = _mm256_add_epi32(_mm256_sub_epi32(sum, _mm256_and_si256(over, ten)), _mm256_and_si256(under, ten));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(carry + i), _mm256_sub_epi32(under, over));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(digit + d * stride + i), sum);
+			__m256i nz = _mm256_load_si256(reinterpret_cast<__m256i*>(nonZero + i));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(nonZero + i), _mm256_or_si256(nz, sum));
+		}
+	}
+#elif defined SSE
+	__m128i zero = _mm_setzero_si128();
+	__m128i nine = _mm_set1_epi32(9);
+	__m128i ten = _mm_set1_epi32(10);
+	for (int d = 0; d < width; ++d)
+	{
+		for (int i = 0; i < stride; i += 4)
+		{
+			__m128i x = d < a.width ? _mm_load_si128(reinterpret_cast<__m128i*>(a.digit + d * stride + i)) : zero;
+			__m128i y = d < b.width ? _mm_load_si128(reinterpret_cast<__m128i*>(b.digit + d * stride + i)) : zero;
+			__m128i exchange = _mm_load_si128(reinterpret_cast<__m128i*>(swap + i));
+			__m128i factor = _mm_load_si128(reinterpret_cast<__m128i*>(greater + i));
+			__m128i c = _mm_load_si128(reinterpret_cast<__m128i*>(carry + i));
+			__m128i big = _mm_blendv_epi8(x, y, exchange);
+			__m128i small = _mm_blendv_epi8(y, x, exchange);
+			__m128i sum = _mm_add_epi32(_mm_add_epi32(big, _mm_sign_epi32(small, factor)), c);
+			__m128i over = _mm_cmpgt_epi32(sum, nine);
+			__m128i under = _mm_cmpgt_epi32(zero, sum);
+			sum = _mm_add_epi32(_mm_sub_epi32(sum, _mm_and_si128(over, ten)), _mm_and_si128(under, ten));
+			_mm_store_si128(reinterpret_cast<__m128i*>(carry + i), _mm_sub_epi32(under, over));
+			_mm_store_si128(reinterpret_cast<__m128i*>(digit + d * stride + i), sum);
+			__m128i nz = _mm_load_si128(reinterpret_cast<__m128i*>(nonZero + i));
+			_mm_store_si128(reinterpret_cast<__m128i*>(nonZero + i), _mm_or_si128(nz, sum));
+		}
+	}
+#else
+	for (int d = 0; d < width; ++d)
+	{
+		for (int i = 0; i < stride; ++i)
+		{
+			int x = d < a.width ? a.digit[d * stride + i] : 0;
+			int y = d < b.width ? b.digit[d * stride + i] : 0;
+			int sum = swap[i] ? y + greater[i] * x : x + greater[i] * y;
+			sum += carry[i];
+			carry[i] = 0;
+			if (sum > 9)
+			{
+				sum -= 10;
+				carry[i] = 1;
+			}
+			else if (sum < 0)
+			{
+				sum += 10;
+				carry[i] = -1;
+			}
+			digit[d * stride + i] = sum;
+			nonZero[i] |= sum;
+		}
+	}
+#endif
+	for (int i = 0; i < stride; ++i)
+		sign[i] = nonZero[i] != 0 ? (swap[i] ? signB[i] : a.sign[i]) : 0;
+	Bigint::__free_row(swap);
+	Bigint::__free_row(greater);
+	Bigint::__free_row(carry);
+	Bigint::__free_row(nonZero);
+	Bigint::__free_row(signB);
+}
+
+void BigintBatch::add(const BigintBatch &a, const BigintBatch &b)
+{
+	__signed_add(a, b, false);
+}
+
+void BigintBatch::subtract(const BigintBatch &a, const BigintBatch &b)
+{
+	__signed_add(a, b, true);
+}
+
+void BigintBatch::multiply(const BigintBatch &a, const BigintBatch &b)
+{
+	// accumulate the columns first, then sweep the carries once
+	int cells = width * stride;
+	int *acc = (this == &a || this == &b) ? Bigint::__allocate_row(cells) : digit;
+	memset(acc, 0, sizeof(int) * width * stride);
+#if defined AVX
+	for (int i = 0; i < a.width; ++i)
+	{
+		for (int j = 0; j < b.width && i + j < width; ++j)
+		{
+			__m256i *pa = reinterpret_cast<__m256i*>(a.digit + i * stride);
+			__m256i *pb = reinterpret_cast<__m256i*>(b.digit + j * stride);
+			__m256i *pacc = reinterpret_cast<__m256i*>(acc + (i + j) * stride);
+			for (int k = 0; k < stride / 8; ++k)
+				_mm256_store_si256(pacc + k, _mm256_add_epi32(_mm256_load_si256(pacc + k),
+					_mm256_mullo_epi32(_mm256_load_si256(pa + k), _mm256_load_si256(pb + k))));
+		}
+	}
+	__m256i ten = _mm256_set1_epi32(10);
+	__m256i one = _mm256_set1_epi32(1);
+	__m256 tenth = _mm256_set1_ps(0.1f);
+	for (int i = 0; i < stride; i += 8)
+	{
+		__m256i carry = _mm256_setzero_si256();
+		__m256i nonZero = _mm256_setzero_si256();
+		for (int d = 0; d < width; ++d)
+		{
+			__m256i *pacc = reinterpret_cast<__m256i*>(acc + d * stride + i);
+			__m256i value = _mm256_add_epi32(_mm256_load_si256(pacc), carry);
+			// the float quotient is off by at most one, fix it up with the remainder
+			__m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(value), tenth));
+			__m256i r = _mm256_sub_epi32(value, _mm256_mullo_epi32(q, ten));
+			__m256i under = _mm256_cmpgt_epi32(_mm256_setzero_si256(), r);
+			__m256i over = _mm256_cmpgt_epi32(r, _mm256_set1_epi32(9));
+			q = _mm256_add_epi32(q, _mm256_sub_epi32(_mm256_and_si256(over, one), _mm256_and_si256(under, one)));
+			r = _mm256_add_epi32(_mm256_sub_epi32(r, _mm256_and_si256(over, ten)), _mm256_and_si256(under, ten));
+			carry = q;
+			nonZero = _mm256_or_si256(nonZero, r);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(digit + d * stride + i), r);
+		}
+		__m256i sa = _mm256_load_si256(reinterpret_cast<__m256i*>(a.sign + i));
+		__m256i sb = _mm256_load_si256(reinterpret_cast<__m256i*>(b.sign + i));
+		__m256i isZero = _mm256_cmpeq_epi32(nonZero, _mm256_setzero_si256());
+		_mm256_store_si256(reinterpret_cast<__m256i*>(sign + i), _mm256_andnot_si256(isZero, _mm256_xor_si256(sa, sb)));
+	}
+#elif defined SSE
+	for (int i = 0; i < a.width; ++i)
+	{
+		for (int j = 0; j < b.width && i + j < width; ++j)
+		{
+			__m128i *pa = reinterpret_cast<__m128i*>(a.digit + i * stride);
+			__m128i *pb = reinterpret_cast<__m128i*>(b.digit + j * stride);
+			__m128i *pacc = reinterpret_cast<__m128i*>(acc + (i + j) * stride);
+			for (int k = 0; k < stride / 4; ++k)
+				_mm_store_si128(pacc + k, _mm_add_epi32(_mm_load_si128(pacc + k),
+					_mm_mullo_epi32(_mm_load_si128(pa + k), _mm_load_si128(pb + k))));
+		}
+	}
+	__m128i ten = _mm_set1_epi32(10);
+	__m128i one = _mm_set1_epi32(1);
+	__m128 tenth = _mm_set1_ps(0.1f);
+	for (int i = 0; i < stride; i += 4)
+	{
+		__m128i carry = _mm_setzero_si128();
+		__m128i nonZero = _mm_setzero_si128();
+		for (int d = 0; d < width; ++d)
+		{
+			__m128i *pacc = reinterpret_cast<__m128i*>(acc + d * stride + i);
+			__m128i value = _mm_add_epi32(_mm_load_si128(pacc), carry);
+			// the float quotient is off by at most one, fix it up with the remainder
+			__m128i q = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(value), tenth));
+			__m128i r = _mm_sub_epi32(value, _mm_mullo_epi32(q, ten));
+			__m128i under = _mm_cmpgt_epi32(_mm_setzero_si128(), r);
+			__m128i over = _mm_cmpgt_epi32(r, _mm_set1_epi32(9));
+			q = _mm_add_epi32(q, _mm_sub_epi32(_mm_and_si128(over, one), _mm_and_si128(under, one)));
+			r = _mm_add_epi32(_mm_sub_epi32(r, _mm_and_si128(over, ten)), _mm_and_si128(under, ten));
+			carry = q;
+			nonZero = _mm_or_si128(nonZero, r);
+			_mm_store_si128(reinterpret_cast<__m128i*>(digit + d * stride + i), r);
+		}
+		__m128i sa = _mm_load_si128(reinterpret_cast<__m128i*>(a.sign + i));
+		__m128i sb = _mm_load_si128(reinterpret_cast<__m128i*>(b.sign + i));
+		__m128i isZero = _mm_cmpeq_epi32(nonZero, _mm_setzero_si128());
+		_mm_store_si128(reinterpret_cast<__m128i*>(sign + i), _mm_andnot_si128(isZero, _mm_xor_si128(sa, sb)));
+	}
+#else
+	for (int i = 0; i < a.width; ++i)
+		for (int j = 0; j < b.width && i + j < width; ++j)
+			for (int k = 0; k < stride; ++k)
+				acc[(i + j) * stride + k] += a.digit[i * stride + k] * b.digit[j * stride + k];
+	for (int k = 0; k < stride; ++k)
+	{
+		int carry = 0, nonZero = 0;
+		for (int d = 0; d < width; ++d)
+		{
+			int value = acc[d * stride + k] + carry;
+			carry = value / 10;
+			digit[d * stride + k] = value % 10;
+			nonZero |= value % 10;
+		}
+		sign[k] = nonZero != 0 ? a.sign[k] ^ b.sign[k] : 0;
+	}
+#endif
+	if (acc != digit)
+		Bigint::__free_row(acc);
+}
+
+// result[i] is -1, 0 or 1 as (*this)[i] is smaller than, equal to or greater than b[i]
+void BigintBatch::compare(const BigintBatch &b, int *result)
+{
+	int lanes = stride;
+	int *less = Bigint::__allocate_row(lanes);
+	int *greater = Bigint::__allocate_row(lanes);
+	__magnitude_order(*this, b, less, greater);
+	for (int i = 0; i < count; ++i)
+	{
+		if (sign[i] != b.sign[i])
+			result[i] = sign[i] ? -1 : 1;
+		else if (sign[i])
+			result[i] = less[i] ? 1 : (greater[i] ? -1 : 0);
+		else
+			result[i] = less[i] ? -1 : (greater[i] ? 1 : 0);
+	}
+	Bigint::__free_row(less);
+	Bigint::__free_row(greater);
+}
+
+class BigintRNS
+{
+	static const int __MAX_MODULI = 65536;
+	int count;
+	const unsigned int *modulus;
+	unsigned int *residue;
+	static const unsigned int * __moduli(int count_);
+	static bool __is_prime(unsigned int n);
+	static unsigned int __power(unsigned int base, unsigned int exp, unsigned int mod)
+	{
+		unsigned long long result = 1, b = base % mod;
+		for (; exp; exp >>= 1)
+		{
+			if (exp & 1)
+				result = result * b % mod;
+			b = b * b % mod;
+		}
+		return (unsigned int)result;
+	}
+	void __check_count(const BigintRNS &x) const
+	{
+		if (count != x.count)
+			throw std::invalid_argument("BigintRNS: operands built with different digit counts");
+	}
+	void __allocate()
+	{
+		int cap = count;
+		residue = reinterpret_cast<unsigned int*>(Bigint::__allocate_row(cap));
+		memset(residue, 0, sizeof(unsigned int) * cap);
+	}
+
+public:
+	explicit BigintRNS(int digits) : count(digits / 9 + 2)
+	{
+		modulus = __moduli(count);
+		__allocate();
+	}
+	BigintRNS(const Bigint &x, int digits);
+	BigintRNS(const BigintRNS &x) : count(x.count), modulus(x.modulus)
+	{
+		__allocate();
+		memcpy(residue, x.residue, sizeof(unsigned int) * count);
+	}
+	BigintRNS(BigintRNS &&x) : count(x.count), modulus(x.modulus), residue(x.residue)
+	{
+		x.residue = NULL;
+	}
+	~BigintRNS()
+	{
+		if (residue != NULL)
+			Bigint::__free_row(reinterpret_cast<int*>(residue));
+	}
+	BigintRNS& operator=(const BigintRNS &x);
+	BigintRNS& operator=(BigintRNS &&x);
+	int getModuliCount()
+	{
+		return count;
+	}
+	BigintRNS operator+(const BigintRNS &x);
+	BigintRNS operator-(const BigintRNS &x);
+	BigintRNS operator*(const BigintRNS &x);
+	Bigint toBigint();
+};
+
+bool BigintRNS::__is_prime(unsigned int n)
+{
+	// Miller-Rabin with bases 2, 7, 61 is exact below 2^32
+	static const unsigned int bases[3] = { 2, 7, 61 };
+	unsigned int d = n - 1;
+	int r = 0;
+	while ((d & 1) == 0)
+	{
+		d >>= 1;
+		++r;
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		unsigned long long x = __power(bases[i], d, n);
+		if (x == 1 || x == n - 1)
+			continue;
+		bool composite = true;
+		for (int j = 1; j < r && composite; ++j)
+		{
+			x = x * x % n;
+			if (x == n - 1)
+				composite = false;
+		}
+		if (composite)
+			return false;
+	}
+	return true;
+}
+
+// the largest primes below 2^31, generated on demand; there are at most
+// __MAX_MODULI of them and room for all is reserved up front,
+// so the table never reallocates and returned pointers stay valid
+const unsigned int * BigintRNS::__moduli(int count_)
+{
+	static std::vector<unsigned int> table;
+	static std::mutex lock;
+	if (count_ > __MAX_MODULI)
+		throw std::length_error("BigintRNS: too many digits");
+	std::lock_guard<std::mutex> guard(lock);
+	if (table.capacity() == 0)
+		table.reserve(__MAX_MODULI);
+	unsigned int candidate = table.empty() ? 0x7FFFFFFFu : table.back() - 2;
+	while ((int)table.size() < count_)
+	{
+		if (__is_prime(candidate))
+			table.push_back(candidate);
+		candidate -= 2;
+	}
+	return table.data();
+}
+
+BigintRNS::BigintRNS(const Bigint &x, int digits) : count(digits / 9 + 2)
+{
+	modulus = __moduli(count);
+	__allocate();
+	for (int k = 0; k < count; ++k)
+	{
+		// nine digits at a time, from the top
+		unsigned long long value = 0;
+		int i = x.size - 1;
+		int head = x.size % 9 == 0 ? 9 : x.size % 9;
+		for (int first = 0; i >= 0; first = 1)
+		{
+			unsigned int chunk = 0, scale = 1;
+			for (int j = 0; j < (first ? 9 : head); ++j, --i)
+			{
+				chunk = chunk * 10 + x.row[i];
+				scale *= 10;
+			}
+			value = (value * scale + chunk) % modulus[k];
+		}
+		if (x.isNegative && value != 0)
+			value = modulus[k] - value;
+		residue[k] = (unsigned int)value;
+	}
+}
+
+BigintRNS& BigintRNS::operator=(const BigintRNS &x)
+{
+	if (this == &x)
+		return *this;
+	if (count != x.count || residue == NULL)
+	{
+		if (residue != NULL)
+			Bigint::__free_row(reinterpret_cast<int*>(residue));
+		count = x.count;
+		__allocate();
+	}
+	modulus = x.modulus;
+	memcpy(residue, x.residue, sizeof(unsigned int) * count);
+	return *this;
+}
+
+BigintRNS& BigintRNS::operator=(BigintRNS &&x)
+{
+	// x keeps the old buffer together with its count
+	std::swap(count, x.count);
+	std::swap(residue, x.residue);
+	modulus = x.modulus;
+	return *this;
+}
+
+BigintRNS BigintRNS::operator+(const BigintRNS &x)
+{
+	__check_count(x);
+	BigintRNS temp(*this);
+	int i = 0;
+#if defined AVX
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(modulus + i));
+		__m256i sum = _mm256_add_epi32(_mm256_load_si256(reinterpret_cast<__m256i*>(residue + i)),
+			_mm256_load_si256(reinterpret_cast<__m256i*>(x.residue + i)));
+		// sum - p wraps around to a huge value when sum < p
+		_mm256_store_si256(reinterpret_cast<__m256i*>(temp.residue + i), _mm256_min_epu32(sum, _mm256_sub_epi32(sum, p)));
+	}
+#elif defined SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(modulus + i));
+		__m128i sum = _mm_add_epi32(_mm_load_si128(reinterpret_cast<__m128i*>(residue + i)),
+			_mm_load_si128(reinterpret_cast<__m128i*>(x.residue + i)));
+		_mm_store_si128(reinterpret_cast<__m128i*>(temp.residue + i), _mm_min_epu32(sum, _mm_sub_epi32(sum, p)));
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		unsigned int sum = residue[i] + x.residue[i];
+		temp.residue[i] = sum >= modulus[i] ? sum - modulus[i] : sum;
+	}
+	return temp;
+}
+
+BigintRNS BigintRNS::operator-(const BigintRNS &x)
+{
+	__check_count(x);
+	BigintRNS temp(*this);
+	int i = 0;
+#if defined AVX
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(modulus + i));
+		__m256i diff = _mm256_sub_epi32(_mm256_load_si256(reinterpret_cast<__m256i*>(residue + i)),
+			_mm256_load_si256(reinterpret_cast<__m256i*>(x.residue + i)));
+		// diff wraps around to a huge value when it should be negative
+		_mm256_store_si256(reinterpret_cast<__m256i*>(temp.residue + i), _mm256_min_epu32(diff, _mm256_add_epi32(diff, p)));
+	}
+#elif defined SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(modulus + i));
+		__m128i diff = _mm_sub_epi32(_mm_load_si128(reinterpret_cast<__m128i*>(residue + i)),
+			_mm_load_si128(reinterpret_cast<__m128i*>(x.residue + i)));
+		_mm_store_si128(reinterpret_cast<__m128i*>(temp.residue + i), _mm_min_epu32(diff, _mm_add_epi32(diff, p)));
+	}
+#endif
+	for (; i < count; ++i)
+		temp.residue[i] = residue[i] >= x.residue[i] ? residue[i] - x.residue[i] : residue[i] + modulus[i] - x.residue[i];
+	return temp;
+}
+
+BigintRNS BigintRNS::operator*(const BigintRNS &x)
+{
+	__check_count(x);
+	BigintRNS temp(*this);
+	for (int i = 0; i < count; ++i)
+		temp.residue[i] = (unsigned int)((unsigned long long)residue[i] * x.residue[i] % modulus[i]);
+	return temp;
+}
+
+Bigint BigintRNS::toBigint()
+{
+	// Garner: find mixed-radix digits v[i] with
+	// x = v[0] + v[1] * m[0] + v[2] * m[0] * m[1] + ...
+	// v[i] = (residue[i] - (v[0] + ... + v[i - 1] * m[0] * ... * m[i - 2])) / (m[0] * ... * m[i - 1]) mod m[i],
+	// the prefix sum and product are kept mod m[i] so there is one inverse per i
+	std::vector<unsigned int> v(count);
+	for (int i = 0; i < count; ++i)
+	{
+		unsigned long long m = modulus[i], sum = 0, product = 1;
+		for (int j = 0; j < i; ++j)
+		{
+			sum = (sum + v[j] % m * product) % m;
+			product = product * (modulus[j] % m) % m;
+		}
+		unsigned long long value = (residue[i] + m - sum) % m;
+		v[i] = (unsigned int)(value * __power((unsigned int)product, (unsigned int)m - 2, (unsigned int)m) % m);
+	}
+	Bigint result, product = Bigint::small(1), factor;
+	for (int i = 0; i < count; ++i)
+	{
+		factor = Bigint::small(v[i]);
+		result = result + factor * product;
+		factor = Bigint::small(modulus[i]);
+		product = product * factor;
+	}
+	// residues stand for the range (-M / 2, M / 2]
+	if (product < result + result)
+		result = result - product;
+	return result;
+}
+
+class BigFloat
+{
+	// value = mantissa * 10^exponent, the mantissa has at most precision digits;
+	// zero always has exponent 0
+	Bigint mantissa;
+	long long exponent;
+	int precision;
+	static Bigint __shift(const Bigint &x, long long k, bool *sticky);
+	static BigFloat __round(const Bigint &m, long long e, int digits, bool sticky);
+	static BigFloat __at(const BigFloat &x, int digits);
+	static BigFloat __estimate(const BigFloat &x, bool root);
+	static std::vector<int> __newton_steps(int digits);
+	static BigFloat __reciprocal(const BigFloat &x, int digits);
+	static BigFloat __reciprocal_root(const BigFloat &x, int digits);
+	long long __top() const
+	{
+		return exponent + mantissa.size;
+	}
+
+public:
+	explicit BigFloat(int precision_ = 50) : exponent(0), precision(precision_)
+	{
+	}
+	BigFloat(const Bigint &x, int precision_)
+	{
+		*this = __round(x, 0, precision_, false);
+	}
+	static BigFloat fromString(const char *input_, int precision_);
+	std::string toString() const;
+	int getPrecision() const
+	{
+		return precision;
+	}
+	void setPrecision(int precision_)
+	{
+		*this = __round(mantissa, exponent, precision_, false);
+	}
+	bool isZero() const
+	{
+		return mantissa.isZero();
+	}
+	int compare(const BigFloat &x) const;
+	bool operator<(const BigFloat &x) const
+	{
+		return compare(x) < 0;
+	}
+	bool operator==(const BigFloat &x) const
+	{
+		return compare(x) == 0;
+	}
+	BigFloat operator-() const;
+	BigFloat operator+(const BigFloat &x) const;
+	BigFloat operator-(const BigFloat &x) const;
+	BigFloat operator*(const BigFloat &x) const;
+	BigFloat operator/(const BigFloat &x) const;
+	BigFloat sqrt() const;
+};
+
+// x * 10^k; for k < 0 the dropped digits are cut off and reported through sticky
+Bigint BigFloat::__shift(const Bigint &x, long long k, bool *sticky)
+{
+	if (k == 0 || x.isZero())
+		return x;
+	if (k > 0)
+	{
+		Bigint temp(x.size + int(k) + 1);
+		memcpy(temp.row + k, x.row, sizeof(int) * x.size);
+		temp.size = x.size + int(k);
+		temp.isNegative = x.isNegative;
+		return temp;
+	}
+	int drop = -k < x.size ? int(-k) : x.size;
+	if (sticky != NULL)
+		for (int i = 0; i < drop && !*sticky; ++i)
+			*sticky = x.row[i] != 0;
+	if (drop == x.size)
+		return Bigint();
+	Bigint temp(x.size - drop + 1);
+	memcpy(temp.row, x.row + drop, sizeof(int) * (x.size - drop));
+	temp.size = x.size - drop;
+	temp.isNegative = x.isNegative;
+	return temp;
+}
+
+// rounds m * 10^e to digits digits, to nearest with ties to even;
+// sticky means the exact value is a little larger in magnitude than m * 10^e
+BigFloat BigFloat::__round(const Bigint &m, long long e, int digits, bool sticky)
+{
+	BigFloat result(digits);
+	if (m.isZero())
+		return result;
+	int drop = m.size - digits;
+	if (drop <= 0)
+	{
+		result.mantissa = m;
+		result.exponent = e;
+		return result;
+	}
+	int first = m.row[drop - 1];
+	bool rest = sticky;
+	for (int i = 0; i < drop - 1 && !rest; ++i)
+		rest = m.row[i] != 0;
+	Bigint kept = __shift(m, -drop, NULL);
+	if (first > 5 || (first == 5 && (rest || kept.isOdd())))
+	{
+		kept = kept + Bigint::constant(m.isNegative ? -1 : 1);
+		if (kept.size > digits)
+		{
+			kept = __shift(kept, -1, NULL);
+			++drop;
+		}
+	}
+	result.mantissa = kept;
+	result.exponent = e + drop;
+	return result;
+}
+
+BigFloat BigFloat::__at(const BigFloat &x, int digits)
+{
+	return __round(x.mantissa, x.exponent, digits, false);
+}
+
+BigFloat BigFloat::fromString(const char *input_, int precision_)
+{
+	bool negative = input_[0] == '-';
+	if (negative || input_[0] == '+')
+		++input_;
+	std::string digits;
+	long long exponent = 0;
+	bool fraction = false;
+	for (; *input_ != '\0' && *input_ != 'e' && *input_ != 'E'; ++input_)
+	{
+		if (*input_ == '.')
+			fraction = true;
+		else
+		{
+			if (digits.empty() && *input_ == '0')
+			{
+				if (fraction)
+					--exponent;
+				continue;
+			}
+			digits.push_back(*input_);
+			if (fraction)
+				--exponent;
+		}
+	}
+	if (*input_ != '\0')
+		exponent += atoll(input_ + 1);
+	if (digits.empty())
+		return BigFloat(precision_);
+	if (negative)
+		digits.insert(digits.begin(), '-');
+	Bigint m;
+	m.load(digits.c_str());
+	return __round(m, exponent, precision_, false);
+}
+
+// scientific notation with every digit of the mantissa: "-1.25e+3"
+std::string BigFloat::toString() const
+{
+	if (mantissa.isZero())
+		return "0";
+	std::string digits = mantissa.toString();
+	std::string text;
+	if (mantissa.isNegative)
+	{
+		text.push_back('-');
+		digits.erase(digits.begin());
+	}
+	while (digits.size() > 1 && digits[digits.size() - 1] == '0')
+		digits.erase(digits.end() - 1);
+	text.push_back(digits[0]);
+	if (digits.size() > 1)
+		text += "." + digits.substr(1);
+	char power[32];
+	snprintf(power, sizeof(power), "e%+lld", __top() - 1);
+	return text + power;
+}
+
+// the sign of the difference is exact, rounding never turns it into zero
+int BigFloat::compare(const BigFloat &x) const
+{
+	BigFloat difference = *this - x;
+	if (difference.mantissa.isZero())
+		return 0;
+	return difference.mantissa.isNegative ? -1 : 1;
+}
+
+BigFloat BigFloat::operator-() const
+{
+	BigFloat result = *this;
+	if (!result.mantissa.isZero())
+		result.mantissa.isNegative = !result.mantissa.isNegative;
+	return result;
+}
+
+BigFloat BigFloat::operator-(const BigFloat &x) const
+{
+	return *this + -x;
+}
+
+BigFloat BigFloat::operator+(const BigFloat &x) const
+{
+	int digits = precision > x.precision ? precision : x.precision;
+	if (mantissa.isZero())
+		return __at(x, digits);
+	if (x.mantissa.isZero())
+		return __at(*this, digits);
+	// digits far below the result only matter as a sticky 1 in front of them
+	long long top = __top() > x.__top() ? __top() : x.__top();
+	long long low = top - digits - 3;
+	Bigint m[2] = { mantissa, x.mantissa };
+	long long e[2] = { exponent, x.exponent };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (e[i] >= low)
+			continue;
+		bool sticky = false;
+		m[i] = __shift(m[i], e[i] - low, &sticky);
+		e[i] = low;
+		if (sticky)
+		{
+			bool negative = i == 0 ? mantissa.isNegative : x.mantissa.isNegative;
+			m[i] = __shift(m[i], 1, NULL) + Bigint::constant(negative ? -1 : 1);
+			e[i] = low - 1;
+		}
+	}
+	long long common = e[0] < e[1] ? e[0] : e[1];
+	Bigint sum = __shift(m[0], e[0] - common, NULL);
+	sum = sum + __shift(m[1], e[1] - common, NULL);
+	return __round(sum, common, digits, false);
+}
+
+BigFloat BigFloat::operator*(const BigFloat &x) const
+{
+	int digits = precision > x.precision ? precision : x.precision;
+	Bigint product = mantissa;
+	product = product * x.mantissa;
+	return __round(product, exponent + x.exponent, digits, false);
+}
+
+// about 16 correct digits of 1 / x or 1 / sqrt(x) from a double
+BigFloat BigFloat::__estimate(const BigFloat &x, bool root)
+{
+	int used = x.mantissa.size < 17 ? x.mantissa.size : 17;
+	double leading = 0;
+	for (int i = x.mantissa.size - 1; i >= x.mantissa.size - used; --i)
+		leading = leading * 10 + x.mantissa.row[i];
+	// x = leading * 10^power with leading in [1, 10)
+	long long power = x.__top() - 1;
+	leading /= pow(10.0, used - 1);
+	double value;
+	if (root)
+	{
+		if (power % 2 != 0)
+		{
+			leading *= 10;
+			--power;
+		}
+		value = 1 / ::sqrt(leading);
+		power = -power / 2;
+	}
+	else
+	{
+		value = 1 / leading;
+		power = -power;
+	}
+	int shift = 15 - (int)floor(log10(value));
+	Bigint m = Bigint::small((long long)llround(value * pow(10.0, shift)));
+	m.isNegative = x.mantissa.isNegative && !root;
+	return __round(m, power - shift, 16, false);
+}
+
+// working precisions from about 14 digits up to digits, each at most twice the last
+std::vector<int> BigFloat::__newton_steps(int digits)
+{
+	std::vector<int> steps;
+	for (int w = digits; w > 14; w = w / 2 + 2)
+		steps.push_back(w);
+	return steps;
+}
+
+// y += y * (1 - x * y)
+BigFloat BigFloat::__reciprocal(const BigFloat &x, int digits)
+{
+	BigFloat y = __estimate(x, false);
+	std::vector<int> steps = __newton_steps(digits);
+	for (int i = (int)steps.size() - 1; i >= 0; --i)
+	{
+		int w = steps[i];
+		BigFloat one(Bigint::constant(1), w);
+		y = __at(y, w);
+		BigFloat error = one - __at(x, w) * y;
+		y = y + y * error;
+	}
+	return y;
+}
+
+// y += y * (1 - x * y * y) / 2
+BigFloat BigFloat::__reciprocal_root(const BigFloat &x, int digits)
+{
+	BigFloat y = __estimate(x, true);
+	std::vector<int> steps = __newton_steps(digits);
+	for (int i = (int)steps.size() - 1; i >= 0; --i)
+	{
+		int w = steps[i];
+		BigFloat one(Bigint::constant(1), w);
+		BigFloat half = __round(Bigint::constant(5), -1, w, false);
+		y = __at(y, w);
+		BigFloat error = one - __at(x, w) * y * y;
+		y = y + y * (error * half);
+	}
+	return y;
+}
+
+BigFloat BigFloat::operator/(const BigFloat &x) const
+{
+	int digits = precision > x.precision ? precision : x.precision;
+	if (mantissa.isZero() || x.mantissa.isZero())
+		return BigFloat(digits);
+	BigFloat estimate = __at(*this, digits + 4) * __reciprocal(x, digits + 4);
+	// q = estimate with digits + 2 digits, then made exact: q <= a / b < q + 1
+	// in units of 10^e, where a / b = u / v * 10^(e)
+	long long e = estimate.__top() - (digits + 2);
+	Bigint q = __shift(estimate.mantissa, estimate.exponent - e, NULL);
+	q.isNegative = false;
+	Bigint u = mantissa, v = x.mantissa;
+	u.isNegative = v.isNegative = false;
+	long long s = exponent - x.exponent - e;
+	if (s > 0)
+		u = __shift(u, s, NULL);
+	else
+		v = __shift(v, -s, NULL);
+	Bigint rest = u;
+	rest = rest - q * v;
+	while (rest < Bigint::constant(0))
+	{
+		q = q - Bigint::constant(1);
+		rest = rest + v;
+	}
+	while (!(rest < v))
+	{
+		q = q + Bigint::constant(1);
+		rest = rest - v;
+	}
+	q.isNegative = mantissa.isNegative != x.mantissa.isNegative;
+	return __round(q, e, digits, !rest.isZero());
+}
+
+BigFloat BigFloat::sqrt() const
+{
+	if (mantissa.isZero() || mantissa.isNegative)
+		return BigFloat(precision);
+	BigFloat estimate = __at(*this, precision + 4) * __reciprocal_root(*this, precision + 4);
+	// r = estimate with precision + 2 digits, then made exact: r^2 <= a < (r + 1)^2
+	// in units of 10^e, where a = u * 10^(2e) / v
+	long long e = estimate.__top() - (precision + 2);
+	Bigint r = __shift(estimate.mantissa, estimate.exponent - e, NULL);
+	Bigint u = mantissa, v = Bigint::constant(1);
+	long long s = exponent - 2 * e;
+	if (s > 0)
+		u = __shift(u, s, NULL);
+	else
+		v = __shift(v, -s, NULL);
+	Bigint square = r;
+	square = square * r * v;
+	while (u < square)
+	{
+		r = r - Bigint::constant(1);
+		square = r;
+		square = square * r * v;
+	}
+	while (true)
+	{
+		Bigint next = r + Bigint::constant(1);
+		Bigint nextSquare = next;
+		nextSquare = nextSquare * next * v;
+		if (u < nextSquare)
+			break;
+		r = next;
+		square = nextSquare;
+	}
+	return __round(r, e, precision, !(square == u));
+}
+
+namespace std
+{
+	template <>
+	struct hash<Bigint>
+	{
+		size_t operator()(const Bigint &x) const
+		{
+			return x.hash();
+		}
+	};
+}
+
+#if __cplusplus >= 201402L
+
+template <int Bits>
+class FixedBigint
+{
+	// little-endian 32-bit limbs, bits above Bits are always 0
+	static const int LIMBS = (Bits + 31) / 32;
+	static const unsigned int TOP_MASK = Bits % 32 == 0 ? 0xFFFFFFFFu : (1u << (Bits % 32)) - 1;
+	unsigned int limb[LIMBS];
+	constexpr void __trim()
+	{
+		limb[LIMBS - 1] &= TOP_MASK;
+	}
+	// *this = *this * factor + addend, returns what falls off the top
+	constexpr unsigned int __multiply_add(unsigned int factor, unsigned int addend)
+	{
+		unsigned long long carry = addend;
+		for (int i = 0; i < LIMBS; ++i)
+		{
+			carry += (unsigned long long)limb[i] * factor;
+			limb[i] = (unsigned int)carry;
+			carry >>= 32;
+		}
+		return (unsigned int)carry;
+	}
+	// *this /= divisor, returns the remainder
+	constexpr unsigned int __divide(unsigned int divisor)
+	{
+		unsigned long long rest = 0;
+		for (int i = LIMBS - 1; i >= 0; --i)
+		{
+			rest = (rest << 32) | limb[i];
+			limb[i] = (unsigned int)(rest / divisor);
+			rest %= divisor;
+		}
+		return (unsigned int)rest;
+	}
+
+public:
+	constexpr FixedBigint() : limb{}
+	{
+	}
+	constexpr FixedBigint(unsigned long long x) : limb{}
+	{
+		limb[0] = (unsigned int)x;
+		if (LIMBS > 1)
+			limb[1] = (unsigned int)(x >> 32);
+		__trim();
+	}
+	FixedBigint(const Bigint &x) : limb{}
+	{
+		for (int i = x.size - 1; i >= 0; --i)
+			__multiply_add(10, x.row[i]);
+		if (x.isNegative)
+			*this = FixedBigint() - *this;
+		__trim();
+	}
+	static constexpr FixedBigint fromString(const char *input_)
+	{
+		FixedBigint temp;
+		bool negative = input_[0] == '-';
+		for (int i = negative ? 1 : 0; input_[i] != '\0'; ++i)
+			temp.__multiply_add(10, input_[i] - '0');
+		temp.__trim();
+		if (negative)
+			temp = FixedBigint() - temp;
+		return temp;
+	}
+	Bigint toBigint() const
+	{
+		Bigint temp(LIMBS * 10 + 1);
+		FixedBigint rest = *this;
+		int pos = 0;
+		while (!rest.isZero())
+		{
+			unsigned int chunk = rest.__divide(1000000000u);
+			// the top chunk stops at its last nonzero digit, the buffer has no room for padding
+			for (int i = 0; i < 9 && (chunk != 0 || !rest.isZero()); ++i)
+			{
+				temp.row[pos++] = chunk % 10;
+				chunk /= 10;
+			}
+		}
+		temp.size = 1;
+		for (int i = pos - 1; i >= 0; --i)
+		{
+			if (temp.row[i] != 0)
+			{
+				temp.size = i + 1;
+				break;
+			}
+		}
+		return temp;
+	}
+	constexpr bool isZero() const
+	{
+		for (int i = 0; i < LIMBS; ++i)
+			if (limb[i] != 0)
+				return false;
+		return true;
+	}
+	constexpr bool isOdd() const
+	{
+		return (limb[0] & 1) != 0;
+	}
+	constexpr FixedBigint operator+(const FixedBigint &x) const
+	{
+		FixedBigint temp;
+		unsigned long long carry = 0;
+		for (int i = 0; i < LIMBS; ++i)
+		{
+			carry += (unsigned long long)limb[i] + x.limb[i];
+			temp.limb[i] = (unsigned int)carry;
+			carry >>= 32;
+		}
+		temp.__trim();
+		return temp;
+	}
+	constexpr FixedBigint operator-(const FixedBigint &x) const
+	{
+		FixedBigint temp;
+		unsigned long long borrow = 0;
+		for (int i = 0; i < LIMBS; ++i)
+		{
+			unsigned long long diff = (unsigned long long)limb[i] - x.limb[i] - borrow;
+			temp.limb[i] = (unsigned int)diff;
+			borrow = (diff >> 32) & 1;
+		}
+		temp.__trim();
+		return temp;
+	}
+	constexpr FixedBigint operator*(const FixedBigint &x) const
+	{
+		// only the low LIMBS limbs of the product are kept
+		FixedBigint temp;
+		for (int i = 0; i < LIMBS; ++i)
+		{
+			unsigned long long carry = 0;
+			for (int j = 0; i + j < LIMBS; ++j)
+			{
+				carry += (unsigned long long)limb[i] * x.limb[j] + temp.limb[i + j];
+				temp.limb[i + j] = (unsigned int)carry;
+				carry >>= 32;
+			}
+		}
+		temp.__trim();
+		return temp;
+	}
+	constexpr bool operator==(const FixedBigint &x) const
+	{
+		for (int i = 0; i < LIMBS; ++i)
+			if (limb[i] != x.limb[i])
+				return false;
+		return true;
+	}
+	constexpr bool operator<(const FixedBigint &x) const
+	{
+		for (int i = LIMBS - 1; i >= 0; --i)
+		{
+			if (limb[i] < x.limb[i])
+				return true;
+			else if (limb[i] > x.limb[i])
+				return false;
+		}
+		return false;
+	}
+};
+
+#endif
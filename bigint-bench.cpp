@@ -0,0 +1,178 @@
+/**********
+*  Bigint Benchmark
+*  Times every Bigint operation over operand sizes from 10 to 10^7 digits
+*  and prints the results as JSON on stdout (progress goes to stderr).
+*  One binary covers one instruction set, so build it once per path:
+*      g++ -O2 -mavx2 bigint-bench.cpp -o bench-avx2
+*      g++ -O2 -msse4.1 -DBIGINT_NO_AVX bigint-bench.cpp -o bench-sse
+*      g++ -O2 -DBIGINT_NO_AVX -DBIGINT_NO_SSE bigint-bench.cpp -o bench-scalar
+*  Add -DBENCH_GMP -lgmp to time GMP on the same operands.
+*  Options:
+*      --max-digits N   stop at N digits for every operation
+*      --full           run "*" and "%" up to 10^7 digits too (takes hours)
+***********/
+
+static long long allocations = 0;
+static long long allocatedBytes = 0;
+#define BIGINT_ON_ALLOCATE(bytes) (++allocations, allocatedBytes += (long long)(bytes))
+
+#include "Bigint.h"
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#if defined BENCH_GMP
+#include <gmp.h>
+#endif
+
+#if defined AVX
+static const char *isa = "avx2";
+#elif defined SSE
+static const char *isa = "sse4.1";
+#else
+static const char *isa = "scalar";
+#endif
+
+// keeps the compiler from dropping the timed operations
+static volatile int sink;
+
+static std::string random_digits(int digits)
+{
+	std::string text(digits, '0');
+	text[0] = char('1' + rand() % 9);
+	for (int i = 1; i < digits; ++i)
+		text[i] = char('0' + rand() % 10);
+	return text;
+}
+
+struct Sample
+{
+	double ns;
+	double allocationsPerOp;
+	double bytesPerOp;
+};
+
+// runs op until 200ms have passed (at least once) and averages
+template <class Op>
+static Sample measure(Op op)
+{
+	long long count = 0;
+	long long startAllocations = allocations, startBytes = allocatedBytes;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::duration spent;
+	do
+	{
+		op();
+		++count;
+		spent = std::chrono::steady_clock::now() - start;
+	} while (spent < std::chrono::milliseconds(200));
+	Sample sample;
+	sample.ns = std::chrono::duration<double, std::nano>(spent).count() / count;
+	sample.allocationsPerOp = double(allocations - startAllocations) / count;
+	sample.bytesPerOp = double(allocatedBytes - startBytes) / count;
+	return sample;
+}
+
+static bool firstResult = true;
+
+static void report(const char *library, const char *op, const char *path, int digits, const Sample &sample)
+{
+	printf("%s\n    {\"library\": \"%s\", \"op\": \"%s\", \"path\": \"%s\", \"digits\": %d, "
+		"\"ns_per_op\": %.1f, \"digits_per_s\": %.4g, \"allocs_per_op\": %.2f, \"alloc_bytes_per_op\": %.0f}",
+		firstResult ? "" : ",", library, op, path, digits, sample.ns, digits * 1e9 / sample.ns,
+		sample.allocationsPerOp, sample.bytesPerOp);
+	firstResult = false;
+	fprintf(stderr, "%-6s %-8s %-7s %9d digits %14.1f ns\n", library, op, path, digits, sample.ns);
+}
+
+static void bench_bigint(int digits, int maxMultiply, int maxModulo)
+{
+	std::string textA = random_digits(digits), textB = random_digits(digits), textHalf = random_digits(digits / 2 + 1);
+	Bigint a, b, half;
+	a.load(textA.c_str());
+	b.load(textB.c_str());
+	half.load(textHalf.c_str());
+	std::vector<char> buffer(digits + 2);
+
+	// "+", "-", "*" and "%" go through the SIMD kernels unless the thresholds forbid it
+	Bigint::Tuning &tuning = Bigint::tuning();
+	Bigint::Tuning saved = tuning;
+#if defined AVX || defined SSE
+	const int paths = 2;
+#else
+	const int paths = 1;
+#endif
+	for (int p = 0; p < paths; ++p)
+	{
+		const char *path = p == 0 ? "scalar" : isa;
+		tuning.addSimdMinDigits = tuning.mulSimdMinDigits = p == 0 ? INT_MAX : 0;
+		report("bigint", "add", path, digits, measure([&] { Bigint c = a + b; sink = sink + c.isOdd(); }));
+		report("bigint", "sub", path, digits, measure([&] { Bigint c = a - b; sink = sink + c.isOdd(); }));
+		if (digits <= maxMultiply)
+			report("bigint", "mul", path, digits, measure([&] { Bigint c = a * b; sink = sink + c.isOdd(); }));
+		if (digits <= maxModulo)
+			report("bigint", "mod", path, digits, measure([&] { Bigint c = a % half; sink = sink + c.isOdd(); }));
+	}
+	tuning = saved;
+	report("bigint", "load", "scalar", digits, measure([&] { Bigint c; c.load(textA.c_str()); sink = sink + c.isOdd(); }));
+	report("bigint", "extract", "scalar", digits, measure([&] { a.extract(buffer.data()); sink = sink + buffer[0]; }));
+}
+
+#if defined BENCH_GMP
+static void bench_gmp(int digits, int maxMultiply, int maxModulo)
+{
+	std::string textA = random_digits(digits), textB = random_digits(digits), textHalf = random_digits(digits / 2 + 1);
+	mpz_t a, b, half, c;
+	mpz_init_set_str(a, textA.c_str(), 10);
+	mpz_init_set_str(b, textB.c_str(), 10);
+	mpz_init_set_str(half, textHalf.c_str(), 10);
+	mpz_init(c);
+	std::vector<char> buffer(digits + 2);
+	report("gmp", "add", "gmp", digits, measure([&] { mpz_add(c, a, b); sink = sink + mpz_odd_p(c); }));
+	report("gmp", "sub", "gmp", digits, measure([&] { mpz_sub(c, a, b); sink = sink + mpz_odd_p(c); }));
+	if (digits <= maxMultiply)
+		report("gmp", "mul", "gmp", digits, measure([&] { mpz_mul(c, a, b); sink = sink + mpz_odd_p(c); }));
+	if (digits <= maxModulo)
+		report("gmp", "mod", "gmp", digits, measure([&] { mpz_mod(c, a, half); sink = sink + mpz_odd_p(c); }));
+	report("gmp", "load", "gmp", digits, measure([&] { mpz_set_str(c, textA.c_str(), 10); sink = sink + mpz_odd_p(c); }));
+	report("gmp", "extract", "gmp", digits, measure([&] { mpz_get_str(buffer.data(), 10, a); sink = sink + buffer[0]; }));
+	mpz_clear(a);
+	mpz_clear(b);
+	mpz_clear(half);
+	mpz_clear(c);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+	int maxDigits = 10000000;
+	// schoolbook "*" and shift-subtract "%" are quadratic, keep them short by default
+	int maxMultiply = 100000, maxModulo = 10000;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--max-digits" && i + 1 < argc)
+			maxDigits = atoi(argv[++i]);
+		else if (arg == "--full")
+			maxMultiply = maxModulo = INT_MAX;
+		else
+		{
+			fprintf(stderr, "usage: %s [--max-digits N] [--full]\n", argv[0]);
+			return 1;
+		}
+	}
+	srand(12345);
+	printf("{\n  \"isa\": \"%s\",\n  \"results\": [", isa);
+	for (int digits = 10; digits <= maxDigits; digits *= 10)
+	{
+		bench_bigint(digits, maxMultiply, maxModulo);
+#if defined BENCH_GMP
+		bench_gmp(digits, maxMultiply, maxModulo);
+#endif
+		if (digits > INT_MAX / 10)
+			break;
+	}
+	printf("\n  ]\n}\n");
+	return 0;
+}
@@ -0,0 +1,127 @@
+/**********
+*  Bigint Tuning Tool
+*  Measures the crossovers Bigint.h uses on the current machine
+*  and writes them to bigint_tuning.h (or to the file given as argument).
+*  Build it with the same flags as the code that uses Bigint.h:
+*      g++ -O2 -mavx2 bigint-tune.cpp -o bigint-tune && ./bigint-tune
+***********/
+
+#include "Bigint.h"
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <string>
+
+// keeps the compiler from dropping the timed operations
+static volatile int sink;
+
+static Bigint random_bigint(int digits)
+{
+	std::string text(digits, '0');
+	text[0] = char('1' + rand() % 9);
+	for (int i = 1; i < digits; ++i)
+		text[i] = char('0' + rand() % 10);
+	Bigint temp;
+	temp.load(text.c_str());
+	return temp;
+}
+
+// nanoseconds per operation, best of three runs of at least 20ms each
+static double time_op(Bigint &a, Bigint &b, bool multiply)
+{
+	double best = 1e300;
+	for (int run = 0; run < 3; ++run)
+	{
+		long long count = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::duration spent;
+		do
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				Bigint c = multiply ? a * b : a + b;
+				sink = sink + c.isOdd();
+			}
+			count += 16;
+			spent = std::chrono::steady_clock::now() - start;
+		} while (spent < std::chrono::milliseconds(20));
+		double ns = std::chrono::duration<double, std::nano>(spent).count() / count;
+		if (ns < best)
+			best = ns;
+	}
+	return best;
+}
+
+// the smallest size from which SIMD is never slower than the plain loops
+// (within 5%, timings of small operations are noisy)
+static int find_simd_crossover(bool multiply, int &setting)
+{
+	static const int sizes[] = { 1, 2, 4, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256 };
+	const int count = sizeof(sizes) / sizeof(sizes[0]);
+	int crossover = INT_MAX;
+	for (int i = count - 1; i >= 0; --i)
+	{
+		Bigint a = random_bigint(sizes[i]), b = random_bigint(sizes[i]);
+		setting = 0;
+		double simd = time_op(a, b, multiply);
+		setting = INT_MAX;
+		double plain = time_op(a, b, multiply);
+		printf("  %s %4d digits: simd %10.1f ns, plain %10.1f ns\n", multiply ? "*" : "+", sizes[i], simd, plain);
+		if (simd > plain * 1.05)
+			break;
+		crossover = sizes[i];
+	}
+	return crossover;
+}
+
+static int find_carry_sweep()
+{
+	// larger values could overflow a column: 10 + 81 * sweep must stay below 2^31
+	static const int candidates[] = { 250000, 1000000, 4000000, 16000000, 26000000 };
+	const int count = sizeof(candidates) / sizeof(candidates[0]);
+	Bigint a = random_bigint(20000), b = random_bigint(20000);
+	int best = candidates[0];
+	double bestTime = 1e300;
+	for (int i = 0; i < count; ++i)
+	{
+		Bigint::tuning().carrySweep = candidates[i];
+		double ns = time_op(a, b, true);
+		printf("  sweep every %8d products: %12.0f ns\n", candidates[i], ns);
+		if (ns < bestTime)
+		{
+			bestTime = ns;
+			best = candidates[i];
+		}
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	const char *output = argc > 1 ? argv[1] : "bigint_tuning.h";
+	Bigint::Tuning &tuning = Bigint::tuning();
+	srand(12345);
+
+	printf("SIMD crossover for \"+\", \"-\":\n");
+	int addSimd = find_simd_crossover(false, tuning.addSimdMinDigits);
+	printf("SIMD crossover for \"*\":\n");
+	int mulSimd = find_simd_crossover(true, tuning.mulSimdMinDigits);
+	tuning.addSimdMinDigits = addSimd;
+	tuning.mulSimdMinDigits = mulSimd;
+	printf("carry sweep in \"*\":\n");
+	int carrySweep = find_carry_sweep();
+
+	FILE *file = fopen(output, "w");
+	if (file == NULL)
+	{
+		fprintf(stderr, "cannot write %s\n", output);
+		return 1;
+	}
+	fprintf(file, "// generated by bigint-tune, run it again on a different CPU\n");
+	fprintf(file, "#define BIGINT_CARRY_SWEEP %d\n", carrySweep);
+	fprintf(file, "#define BIGINT_ADD_SIMD_MIN_DIGITS %d\n", addSimd);
+	fprintf(file, "#define BIGINT_MUL_SIMD_MIN_DIGITS %d\n", mulSimd);
+	fclose(file);
+	printf("written to %s\n", output);
+	return 0;
+}
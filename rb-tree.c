@@ -22,6 +22,20 @@ inline static int __rb_data_less(struct __rb_data *x, struct __rb_data *y)
 	return x->val < y->val;
 }
 
+// choose the node layout (at most one of them):
+// RB_COMPACT keeps the color in the lowest bit of the parent pointer;
+// RB_INDEX32 links nodes by 32-bit indices into the slabs of their tree
+// and keeps the color in the lowest bit of the parent index
+// #define RB_COMPACT
+// #define RB_INDEX32
+
+// uncomment to keep subtree sizes in the nodes, for rb_select and rb_rank
+// #define RB_ORDER_STATISTIC
+
+// uncomment to let rb_union, rb_intersection and rb_difference recurse
+// on several threads at once (needs C++11 threads, link with -pthread)
+// #define RB_PARALLEL
+
 /**********
 *  End Template Block
 ***********/
@@ -31,14 +45,59 @@ inline static int __rb_data_less(struct __rb_data *x, struct __rb_data *y)
 *  Tree Structure Defination Block
 ***********/
 
+#if defined RB_PARALLEL
+#include <thread>
+#endif
+
 enum __rb_color { __rb_BLACK, __rb_RED };
 
+#if defined RB_INDEX32
+typedef struct __rb_node
+{
+	unsigned int lc, rc;
+	// parent index * 2 + color
+	unsigned int pa_color;
+#if defined RB_ORDER_STATISTIC
+	unsigned int size;
+#endif
+	__rb_data dat;
+};
+#elif defined RB_COMPACT
+typedef struct __rb_node
+{
+	struct __rb_node *lc, *rc;
+	// parent pointer | color, nodes are at least 4-byte aligned
+	size_t pa_color;
+#if defined RB_ORDER_STATISTIC
+	unsigned int size;
+#endif
+	__rb_data dat;
+};
+#else
 typedef struct __rb_node
 {
 	struct __rb_node *lc, *rc, *pa;
 	__rb_color color;
+#if defined RB_ORDER_STATISTIC
+	// nodes in the subtree rooted here, 0 for the sentinel
+	unsigned int size;
+#endif
 	__rb_data dat;
 };
+#endif
+
+// nodes are carved out of slabs of this many bytes, each aligned to its own size
+// so that the slab of a node can be found from its address
+#define __RB_SLAB_BYTES 65536
+
+// kept in the first node slots of every slab, the nodes follow
+struct __rb_slab
+{
+	unsigned int index;
+};
+
+#define __RB_SLAB_NODES (__RB_SLAB_BYTES / sizeof(struct __rb_node))
+#define __RB_SLAB_HEADER_NODES ((sizeof(struct __rb_slab) + sizeof(struct __rb_node) - 1) / sizeof(struct __rb_node))
 
 /**********
 *  End Tree Structure Defination Block
@@ -46,16 +105,81 @@ typedef struct __rb_node
 
 
 /**********
-*  Global Variable Block
+*  Tree Handle Block
+*  Every tree is one of these; any number of them can live side by side.
+*      struct rb_tree index;
+*      rb_init_tree(&index);
+*      rb_insert_data(&index, data);
+*      rb_destruct_tree(&index);
+***********/
+
+struct rb_tree
+{
+	struct __rb_node *root;
+	// each tree has its own sentinel, the fixups write into its parent link;
+	// it comes from the slabs like every other node
+	struct __rb_node *NIL;
+	// node allocator: the start of every slab, the unused tail of the newest one,
+	// and the deleted nodes chained through lc and ended by NIL
+	struct __rb_node **slabs;
+	unsigned int slab_count, slab_capacity;
+	struct __rb_node *slab_next, *slab_end;
+	struct __rb_node *free_nodes;
+};
+
+/**********
+*  End Tree Handle Block
 ***********/
 
-__rb_node __rb_tmp_node;
 
-struct __rb_node *__rb_root = NULL;
-struct __rb_node *__rb_NIL = NULL;
 
 /**********
-*  End Global Variable Block
+*  Node Access Block
+*  All links go through these, whatever the layout.
+***********/
+
+#if defined RB_INDEX32
+inline static struct __rb_node * __rb_node_at(struct rb_tree *tree, unsigned int i)
+{
+	return tree->slabs[i / __RB_SLAB_NODES] + i % __RB_SLAB_NODES;
+}
+
+inline static unsigned int __rb_index_of(struct __rb_node *x)
+{
+	struct __rb_node *start = (struct __rb_node *)((size_t)x & ~(size_t)(__RB_SLAB_BYTES - 1));
+	return ((struct __rb_slab *)start)->index * (unsigned int)__RB_SLAB_NODES + (unsigned int)(x - start);
+}
+
+inline static struct __rb_node * __rb_lc(struct rb_tree *tree, struct __rb_node *x) { return __rb_node_at(tree, x->lc); }
+inline static struct __rb_node * __rb_rc(struct rb_tree *tree, struct __rb_node *x) { return __rb_node_at(tree, x->rc); }
+inline static struct __rb_node * __rb_pa(struct rb_tree *tree, struct __rb_node *x) { return __rb_node_at(tree, x->pa_color >> 1); }
+inline static void __rb_set_lc(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->lc = __rb_index_of(y); }
+inline static void __rb_set_rc(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->rc = __rb_index_of(y); }
+inline static void __rb_set_pa(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->pa_color = __rb_index_of(y) << 1 | (x->pa_color & 1); }
+inline static __rb_color __rb_color_of(struct __rb_node *x) { return (__rb_color)(x->pa_color & 1); }
+inline static void __rb_set_color(struct __rb_node *x, __rb_color c) { x->pa_color = (x->pa_color & ~1u) | c; }
+#elif defined RB_COMPACT
+inline static struct __rb_node * __rb_lc(struct rb_tree *, struct __rb_node *x) { return x->lc; }
+inline static struct __rb_node * __rb_rc(struct rb_tree *, struct __rb_node *x) { return x->rc; }
+inline static struct __rb_node * __rb_pa(struct rb_tree *, struct __rb_node *x) { return (struct __rb_node *)(x->pa_color & ~(size_t)1); }
+inline static void __rb_set_lc(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->lc = y; }
+inline static void __rb_set_rc(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->rc = y; }
+inline static void __rb_set_pa(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->pa_color = (size_t)y | (x->pa_color & 1); }
+inline static __rb_color __rb_color_of(struct __rb_node *x) { return (__rb_color)(x->pa_color & 1); }
+inline static void __rb_set_color(struct __rb_node *x, __rb_color c) { x->pa_color = (x->pa_color & ~(size_t)1) | c; }
+#else
+inline static struct __rb_node * __rb_lc(struct rb_tree *, struct __rb_node *x) { return x->lc; }
+inline static struct __rb_node * __rb_rc(struct rb_tree *, struct __rb_node *x) { return x->rc; }
+inline static struct __rb_node * __rb_pa(struct rb_tree *, struct __rb_node *x) { return x->pa; }
+inline static void __rb_set_lc(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->lc = y; }
+inline static void __rb_set_rc(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->rc = y; }
+inline static void __rb_set_pa(struct rb_tree *, struct __rb_node *x, struct __rb_node *y) { x->pa = y; }
+inline static __rb_color __rb_color_of(struct __rb_node *x) { return x->color; }
+inline static void __rb_set_color(struct __rb_node *x, __rb_color c) { x->color = c; }
+#endif
+
+/**********
+*  End Node Access Block
 ***********/
 
 
@@ -64,248 +188,720 @@ struct __rb_node *__rb_NIL = NULL;
 *  Private Function Block
 ***********/
 
-static void __rb_left_rotate(struct __rb_node *x)
-{
-	struct __rb_node *y = x->rc;
-	x->rc = y->lc;
-	if (y->lc != __rb_NIL)
-		y->lc->pa = x;
-	y->pa = x->pa;
-	if (x->pa == __rb_NIL)
-		__rb_root = y;
-	else if (x == x->pa->lc)
-		x->pa->lc = y;
+static struct __rb_node * __rb_new_node(struct rb_tree *tree)
+{
+	struct __rb_node *z;
+	if (tree->free_nodes != tree->NIL)
+	{
+		z = tree->free_nodes;
+		tree->free_nodes = __rb_lc(tree, z);
+		return z;
+	}
+	if (tree->slab_next == tree->slab_end)
+	{
+		if (tree->slab_count == tree->slab_capacity)
+		{
+			tree->slab_capacity = tree->slab_capacity ? tree->slab_capacity * 2 : 16;
+			tree->slabs = (struct __rb_node **)realloc(tree->slabs, sizeof(struct __rb_node *) * tree->slab_capacity);
+		}
+		struct __rb_node *start = (struct __rb_node *)aligned_alloc(__RB_SLAB_BYTES, __RB_SLAB_BYTES);
+		((struct __rb_slab *)start)->index = tree->slab_count;
+		tree->slab_next = start + __RB_SLAB_HEADER_NODES;
+		tree->slab_end = start + __RB_SLAB_NODES;
+		tree->slabs[tree->slab_count++] = start;
+	}
+	return tree->slab_next++;
+}
+
+inline static void __rb_free_node(struct rb_tree *tree, struct __rb_node *z)
+{
+	__rb_set_lc(tree, z, tree->free_nodes);
+	tree->free_nodes = z;
+}
+
+static void __rb_left_rotate(struct rb_tree *tree, struct __rb_node *x)
+{
+	struct __rb_node *y = __rb_rc(tree, x), *p = __rb_pa(tree, x);
+	__rb_set_rc(tree, x, __rb_lc(tree, y));
+	if (__rb_lc(tree, y) != tree->NIL)
+		__rb_set_pa(tree, __rb_lc(tree, y), x);
+	__rb_set_pa(tree, y, p);
+	if (p == tree->NIL)
+		tree->root = y;
+	else if (x == __rb_lc(tree, p))
+		__rb_set_lc(tree, p, y);
 	else
-		x->pa->rc = y;
-	y->lc = x;
-	x->pa = y;
-}
-
-static void __rb_right_rotate(struct __rb_node *x)
-{
-	struct __rb_node *y = x->lc;
-	x->lc = y->rc;
-	if (y->rc != __rb_NIL)
-		y->rc->pa = x;
-	y->pa = x->pa;
-	if (x->pa == __rb_NIL)
-		__rb_root = y;
-	else if (x == x->pa->lc)
-		x->pa->lc = y;
+		__rb_set_rc(tree, p, y);
+	__rb_set_lc(tree, y, x);
+	__rb_set_pa(tree, x, y);
+#if defined RB_ORDER_STATISTIC
+	y->size = x->size;
+	x->size = __rb_lc(tree, x)->size + __rb_rc(tree, x)->size + 1;
+#endif
+}
+
+static void __rb_right_rotate(struct rb_tree *tree, struct __rb_node *x)
+{
+	struct __rb_node *y = __rb_lc(tree, x), *p = __rb_pa(tree, x);
+	__rb_set_lc(tree, x, __rb_rc(tree, y));
+	if (__rb_rc(tree, y) != tree->NIL)
+		__rb_set_pa(tree, __rb_rc(tree, y), x);
+	__rb_set_pa(tree, y, p);
+	if (p == tree->NIL)
+		tree->root = y;
+	else if (x == __rb_lc(tree, p))
+		__rb_set_lc(tree, p, y);
 	else
-		x->pa->rc = y;
-	y->rc = x;
-	x->pa = y;
+		__rb_set_rc(tree, p, y);
+	__rb_set_rc(tree, y, x);
+	__rb_set_pa(tree, x, y);
+#if defined RB_ORDER_STATISTIC
+	y->size = x->size;
+	x->size = __rb_lc(tree, x)->size + __rb_rc(tree, x)->size + 1;
+#endif
 }
 
-static void __rb_insert_fixup(struct __rb_node *z)
+// return 1 when the root had to be turned black, i.e. the black height grew
+static int __rb_insert_fixup(struct rb_tree *tree, struct __rb_node *z)
 {
-	struct __rb_node *x, *y;
-	while (z->pa->color == __rb_RED)
+	// p is the parent of z, g its grandparent, y its uncle
+	struct __rb_node *p, *g, *y;
+	while (__rb_color_of(p = __rb_pa(tree, z)) == __rb_RED)
 	{
-		if (z->pa == z->pa->pa->lc)
+		g = __rb_pa(tree, p);
+		if (p == __rb_lc(tree, g))
 		{
-			y = z->pa->pa->rc;
-			if (y->color == __rb_RED)
+			y = __rb_rc(tree, g);
+			if (__rb_color_of(y) == __rb_RED)
 			{
-				z->pa->color = __rb_BLACK;
-				y->color = __rb_BLACK;
-				z->pa->pa->color = __rb_RED;
-				z = z->pa->pa;
+				__rb_set_color(p, __rb_BLACK);
+				__rb_set_color(y, __rb_BLACK);
+				__rb_set_color(g, __rb_RED);
+				z = g;
 			}
 			else
 			{
-				if (z == z->pa->rc)
+				if (z == __rb_rc(tree, p))
 				{
-					z = z->pa;
-					__rb_left_rotate(z);
+					z = p;
+					__rb_left_rotate(tree, z);
+					p = __rb_pa(tree, z);
 				}
-				z->pa->color = __rb_BLACK;
-				z->pa->pa->color = __rb_RED;
-				__rb_right_rotate(z->pa->pa);
+				__rb_set_color(p, __rb_BLACK);
+				__rb_set_color(g, __rb_RED);
+				__rb_right_rotate(tree, g);
 			}
 		}
 		else
 		{
-			y = z->pa->pa->lc;
-			if (y->color == __rb_RED)
+			y = __rb_lc(tree, g);
+			if (__rb_color_of(y) == __rb_RED)
 			{
-				z->pa->color = __rb_BLACK;
-				y->color = __rb_BLACK;
-				z->pa->pa->color = __rb_RED;
-				z = z->pa->pa;
+				__rb_set_color(p, __rb_BLACK);
+				__rb_set_color(y, __rb_BLACK);
+				__rb_set_color(g, __rb_RED);
+				z = g;
 			}
 			else
 			{
-				if (z == z->pa->lc)
+				if (z == __rb_lc(tree, p))
 				{
-					z = z->pa;
-					__rb_right_rotate(z);
+					z = p;
+					__rb_right_rotate(tree, z);
+					p = __rb_pa(tree, z);
 				}
-				z->pa->color = __rb_BLACK;
-				z->pa->pa->color = __rb_RED;
-				__rb_left_rotate(z->pa->pa);
+				__rb_set_color(p, __rb_BLACK);
+				__rb_set_color(g, __rb_RED);
+				__rb_left_rotate(tree, g);
 			}
 		}
 	}
-	__rb_root->color = __rb_BLACK;
+	if (__rb_color_of(tree->root) == __rb_BLACK)
+		return 0;
+	__rb_set_color(tree->root, __rb_BLACK);
+	return 1;
 }
 
-static void __rb_insert(struct __rb_node *z)
+static void __rb_insert(struct rb_tree *tree, struct __rb_node *z)
 {
-	struct __rb_node *x = __rb_root, *y = __rb_NIL;
-	while (x != __rb_NIL)
+	struct __rb_node *x = tree->root, *y = tree->NIL;
+	while (x != tree->NIL)
 	{
 		y = x;
+#if defined RB_ORDER_STATISTIC
+		++x->size;
+#endif
 		if (__rb_data_less(&z->dat, &x->dat))
-			x = x->lc;
+			x = __rb_lc(tree, x);
 		else
-			x = x->rc;
+			x = __rb_rc(tree, x);
 	}
-	z->pa = y;
-	if (y == __rb_NIL)
-		__rb_root = z;
+	__rb_set_pa(tree, z, y);
+	if (y == tree->NIL)
+		tree->root = z;
 	else if (__rb_data_less(&z->dat, &y->dat))
-		y->lc = z;
+		__rb_set_lc(tree, y, z);
 	else
-		y->rc = z;
-	z->lc = z->rc = __rb_NIL;
-	z->color = __rb_RED;
-	__rb_insert_fixup(z);
+		__rb_set_rc(tree, y, z);
+	__rb_set_lc(tree, z, tree->NIL);
+	__rb_set_rc(tree, z, tree->NIL);
+	__rb_set_color(z, __rb_RED);
+#if defined RB_ORDER_STATISTIC
+	z->size = 1;
+#endif
+	__rb_insert_fixup(tree, z);
 }
 
-inline static void __rb_transplant(struct __rb_node *u, struct __rb_node *v)
+inline static void __rb_transplant(struct rb_tree *tree, struct __rb_node *u, struct __rb_node *v)
 {
-	if (u->pa == __rb_NIL)
-		__rb_root = v;
-	else if (u == u->pa->lc)
-		u->pa->lc = v;
+	struct __rb_node *p = __rb_pa(tree, u);
+	if (p == tree->NIL)
+		tree->root = v;
+	else if (u == __rb_lc(tree, p))
+		__rb_set_lc(tree, p, v);
 	else
-		u->pa->rc = v;
-	v->pa = u->pa;
+		__rb_set_rc(tree, p, v);
+	__rb_set_pa(tree, v, p);
 }
 
-static void __rb_delete_fixup(struct __rb_node *x)
+static void __rb_delete_fixup(struct rb_tree *tree, struct __rb_node *x)
 {
-	struct __rb_node *w;
-	while (x != __rb_root && x->color == __rb_BLACK)
+	// p is the parent of x, w its sibling
+	struct __rb_node *p, *w;
+	while (x != tree->root && __rb_color_of(x) == __rb_BLACK)
 	{
-		if (x == x->pa->lc)
+		p = __rb_pa(tree, x);
+		if (x == __rb_lc(tree, p))
 		{
-			w = x->pa->rc;
-			if (w->color == __rb_RED)
+			w = __rb_rc(tree, p);
+			if (__rb_color_of(w) == __rb_RED)
 			{
-				w->color = __rb_BLACK;
-				x->pa->color = __rb_RED;
-				__rb_left_rotate(x->pa);
-				w = x->pa->rc;
+				__rb_set_color(w, __rb_BLACK);
+				__rb_set_color(p, __rb_RED);
+				__rb_left_rotate(tree, p);
+				w = __rb_rc(tree, p);
 			}
-			if (w->lc->color == __rb_BLACK && w->rc->color == __rb_BLACK)
+			if (__rb_color_of(__rb_lc(tree, w)) == __rb_BLACK && __rb_color_of(__rb_rc(tree, w)) == __rb_BLACK)
 			{
-				w->color = __rb_RED;
-				x = x->pa;
+				__rb_set_color(w, __rb_RED);
+				x = p;
 			}
 			else
 			{
-				if (w->rc->color == __rb_BLACK)
+				if (__rb_color_of(__rb_rc(tree, w)) == __rb_BLACK)
 				{
-					w->lc->color = __rb_BLACK;
-					w->color = __rb_RED;
-					__rb_right_rotate(w);
-					w = x->pa->rc;
+					__rb_set_color(__rb_lc(tree, w), __rb_BLACK);
+					__rb_set_color(w, __rb_RED);
+					__rb_right_rotate(tree, w);
+					w = __rb_rc(tree, p);
 				}
-				w->color = x->pa->color;
-				x->pa->color = __rb_BLACK;
-				w->rc->color = __rb_BLACK;
-				__rb_left_rotate(x->pa);
-				x = __rb_root;
+				__rb_set_color(w, __rb_color_of(p));
+				__rb_set_color(p, __rb_BLACK);
+				__rb_set_color(__rb_rc(tree, w), __rb_BLACK);
+				__rb_left_rotate(tree, p);
+				x = tree->root;
 			}
 		}
 		else
 		{
-			w = x->pa->lc;
-			if (w->color == __rb_RED)
+			w = __rb_lc(tree, p);
+			if (__rb_color_of(w) == __rb_RED)
 			{
-				w->color = __rb_BLACK;
-				x->pa->color = __rb_RED;
-				__rb_right_rotate(x->pa);
-				w = x->pa->lc;
+				__rb_set_color(w, __rb_BLACK);
+				__rb_set_color(p, __rb_RED);
+				__rb_right_rotate(tree, p);
+				w = __rb_lc(tree, p);
 			}
-			if (w->rc->color == __rb_BLACK && w->lc->color == __rb_BLACK)
+			if (__rb_color_of(__rb_rc(tree, w)) == __rb_BLACK && __rb_color_of(__rb_lc(tree, w)) == __rb_BLACK)
 			{
-				w->color = __rb_RED;
-				x = x->pa;
+				__rb_set_color(w, __rb_RED);
+				x = p;
 			}
 			else
 			{
-				if (w->lc->color == __rb_BLACK)
+				if (__rb_color_of(__rb_lc(tree, w)) == __rb_BLACK)
 				{
-					w->rc->color = __rb_BLACK;
-					w->color = __rb_RED;
-					__rb_left_rotate(w);
-					w = x->pa->lc;
+					__rb_set_color(__rb_rc(tree, w), __rb_BLACK);
+					__rb_set_color(w, __rb_RED);
+					__rb_left_rotate(tree, w);
+					w = __rb_lc(tree, p);
 				}
-				w->color = x->pa->color;
-				x->pa->color = __rb_BLACK;
-				w->lc->color = __rb_BLACK;
-				__rb_right_rotate(x->pa);
-				x = __rb_root;
+				__rb_set_color(w, __rb_color_of(p));
+				__rb_set_color(p, __rb_BLACK);
+				__rb_set_color(__rb_lc(tree, w), __rb_BLACK);
+				__rb_right_rotate(tree, p);
+				x = tree->root;
 			}
 		}
 	}
-	x->color = __rb_BLACK;
+	__rb_set_color(x, __rb_BLACK);
 }
 
-inline static struct __rb_node * __rb_tree_minimum(struct __rb_node *x)
+inline static struct __rb_node * __rb_tree_minimum(struct rb_tree *tree, struct __rb_node *x)
 {
-	while (x->lc != __rb_NIL)
-		x = x->lc;
+	while (__rb_lc(tree, x) != tree->NIL)
+		x = __rb_lc(tree, x);
 	return x;
 }
 
-static void __rb_delete(struct __rb_node *z)
+inline static struct __rb_node * __rb_tree_maximum(struct rb_tree *tree, struct __rb_node *x)
+{
+	while (__rb_rc(tree, x) != tree->NIL)
+		x = __rb_rc(tree, x);
+	return x;
+}
+
+static void __rb_delete(struct rb_tree *tree, struct __rb_node *z)
 {
 	struct __rb_node *x, *y = z;
-	__rb_color y_original_color = y->color;
-	if (z->lc == __rb_NIL)
+	__rb_color y_original_color = __rb_color_of(y);
+#if defined RB_ORDER_STATISTIC
+	if (__rb_lc(tree, z) == tree->NIL || __rb_rc(tree, z) == tree->NIL)
+		for (struct __rb_node *a = __rb_pa(tree, z); a != tree->NIL; a = __rb_pa(tree, a))
+			--a->size;
+#endif
+	if (__rb_lc(tree, z) == tree->NIL)
 	{
-		x = z->rc;
-		__rb_transplant(z, z->rc);
+		x = __rb_rc(tree, z);
+		__rb_transplant(tree, z, x);
 	}
-	else if (z->rc == __rb_NIL)
+	else if (__rb_rc(tree, z) == tree->NIL)
 	{
-		x = z->lc;
-		__rb_transplant(z, z->lc);
+		x = __rb_lc(tree, z);
+		__rb_transplant(tree, z, x);
 	}
 	else
 	{
-		y = __rb_tree_minimum(z->rc);
-		y_original_color = y->color;
-		x = y->rc;
-		if (y->pa == z)
-			x->pa = y;
+		y = __rb_tree_minimum(tree, __rb_rc(tree, z));
+#if defined RB_ORDER_STATISTIC
+		// y leaves its place, every node above it loses one
+		for (struct __rb_node *a = __rb_pa(tree, y); a != tree->NIL; a = __rb_pa(tree, a))
+			--a->size;
+		y->size = z->size;
+#endif
+		y_original_color = __rb_color_of(y);
+		x = __rb_rc(tree, y);
+		if (__rb_pa(tree, y) == z)
+			__rb_set_pa(tree, x, y);
 		else
 		{
-			__rb_transplant(y, y->rc);
-			y->rc = z->rc;
-			y->rc->pa = y;
+			__rb_transplant(tree, y, x);
+			__rb_set_rc(tree, y, __rb_rc(tree, z));
+			__rb_set_pa(tree, __rb_rc(tree, y), y);
 		}
-		__rb_transplant(z, y);
-		y->lc = z->lc;
-		y->lc->pa = y;
-		y->color = z->color;
+		__rb_transplant(tree, z, y);
+		__rb_set_lc(tree, y, __rb_lc(tree, z));
+		__rb_set_pa(tree, __rb_lc(tree, y), y);
+		__rb_set_color(y, __rb_color_of(z));
 	}
-	free(z);
+	__rb_free_node(tree, z);
 	if (y_original_color == __rb_BLACK)
-		__rb_delete_fixup(x);
+		__rb_delete_fixup(tree, x);
+}
+
+// builds array[lo, hi) into a perfectly balanced subtree under pa: the middle element
+// is the root, nodes deeper than red_depth - 1 are red and the rest black; nodes are
+// taken from the slabs in order, so neighbours in the array are neighbours in memory
+static struct __rb_node * __rb_build(struct rb_tree *tree, struct __rb_data *array, unsigned int lo, unsigned int hi,
+	struct __rb_node *pa, unsigned int depth, unsigned int red_depth)
+{
+	struct __rb_node *x, *left;
+	unsigned int mid;
+	if (lo == hi)
+		return tree->NIL;
+	mid = lo + (hi - lo) / 2;
+	// the node does not exist yet, so the left subtree gets a parent later
+	left = __rb_build(tree, array, lo, mid, tree->NIL, depth + 1, red_depth);
+	x = __rb_new_node(tree);
+	x->dat = array[mid];
+	__rb_set_pa(tree, x, pa);
+	__rb_set_color(x, depth >= red_depth ? __rb_RED : __rb_BLACK);
+#if defined RB_ORDER_STATISTIC
+	x->size = hi - lo;
+#endif
+	__rb_set_lc(tree, x, left);
+	if (left != tree->NIL)
+		__rb_set_pa(tree, left, x);
+	__rb_set_rc(tree, x, __rb_build(tree, array, mid + 1, hi, x, depth + 1, red_depth));
+	return x;
+}
+
+/**********
+*  Join-Based Operations
+*  A subtree is passed around detached (its root's parent is NIL) together with
+*  its black height: the black nodes on a path from its root down, NIL excluded.
+*  The functions below work on a view of the tree, a copy of the handle with its
+*  own root and free list, so that independent subtrees can be handled on
+*  different threads; none of them allocates a node or writes to the sentinel.
+***********/
+
+#if defined RB_PARALLEL
+// subtrees with a smaller black height are not worth a thread
+#define __RB_PARALLEL_MIN_HEIGHT 8
+#endif
+
+inline static unsigned int __rb_black_height(struct rb_tree *tree, struct __rb_node *x)
+{
+	unsigned int h = 0;
+	for (; x != tree->NIL; x = __rb_lc(tree, x))
+		if (__rb_color_of(x) == __rb_BLACK)
+			++h;
+	return h;
+}
+
+inline static void __rb_detach(struct rb_tree *view, struct __rb_node *x)
+{
+	if (x != view->NIL)
+		__rb_set_pa(view, x, view->NIL);
+}
+
+// make x the root of the tree, black and without a parent
+inline static void __rb_set_root(struct rb_tree *tree, struct __rb_node *x)
+{
+	tree->root = x;
+	if (x != tree->NIL)
+	{
+		__rb_set_pa(tree, x, tree->NIL);
+		__rb_set_color(x, __rb_BLACK);
+	}
+}
+
+// a node-for-node copy of the subtree x of src, allocated in dst, under pa
+static struct __rb_node * __rb_copy(struct rb_tree *dst, struct rb_tree *src, struct __rb_node *x, struct __rb_node *pa)
+{
+	struct __rb_node *y;
+	if (x == src->NIL)
+		return dst->NIL;
+	y = __rb_new_node(dst);
+	y->dat = x->dat;
+	__rb_set_pa(dst, y, pa);
+	__rb_set_color(y, __rb_color_of(x));
+#if defined RB_ORDER_STATISTIC
+	y->size = x->size;
+#endif
+	__rb_set_lc(dst, y, __rb_copy(dst, src, __rb_lc(src, x), y));
+	__rb_set_rc(dst, y, __rb_copy(dst, src, __rb_rc(src, x), y));
+	return y;
+}
+
+static void __rb_free_subtree(struct rb_tree *view, struct __rb_node *x)
+{
+	struct __rb_node *r;
+	while (x != view->NIL)
+	{
+		__rb_free_subtree(view, __rb_lc(view, x));
+		r = __rb_rc(view, x);
+		__rb_free_node(view, x);
+		x = r;
+	}
+}
+
+// join(l, x, r): every element of l is not greater than x, every element of r not less;
+// returns the root of the joined subtree and its black height in h,
+// in O(|hl - hr| + 1) by hanging x off the spine of the taller side
+static struct __rb_node * __rb_join(struct rb_tree *view, struct __rb_node *l, unsigned int hl,
+	struct __rb_node *x, struct __rb_node *r, unsigned int hr, unsigned int *h)
+{
+	struct __rb_node *c, *p = view->NIL;
+	unsigned int ch;
+	if (__rb_color_of(l) == __rb_RED)
+	{
+		__rb_set_color(l, __rb_BLACK);
+		++hl;
+	}
+	if (__rb_color_of(r) == __rb_RED)
+	{
+		__rb_set_color(r, __rb_BLACK);
+		++hr;
+	}
+	if (hl == hr)
+	{
+		__rb_set_lc(view, x, l);
+		__rb_set_rc(view, x, r);
+		if (l != view->NIL)
+			__rb_set_pa(view, l, x);
+		if (r != view->NIL)
+			__rb_set_pa(view, r, x);
+		__rb_set_pa(view, x, view->NIL);
+		__rb_set_color(x, __rb_BLACK);
+#if defined RB_ORDER_STATISTIC
+		x->size = l->size + r->size + 1;
+#endif
+		*h = hl + 1;
+		return x;
+	}
+	if (hl > hr)
+	{
+		// the first black node on the right spine of l as high as r
+		for (c = l, ch = hl; ch != hr || __rb_color_of(c) == __rb_RED; c = __rb_rc(view, c))
+		{
+			if (__rb_color_of(c) == __rb_BLACK)
+				--ch;
+			p = c;
+		}
+		__rb_set_lc(view, x, c);
+		__rb_set_rc(view, x, r);
+		__rb_set_rc(view, p, x);
+		view->root = l;
+	}
+	else
+	{
+		for (c = r, ch = hr; ch != hl || __rb_color_of(c) == __rb_RED; c = __rb_lc(view, c))
+		{
+			if (__rb_color_of(c) == __rb_BLACK)
+				--ch;
+			p = c;
+		}
+		__rb_set_lc(view, x, l);
+		__rb_set_rc(view, x, c);
+		__rb_set_lc(view, p, x);
+		view->root = r;
+	}
+	if (__rb_lc(view, x) != view->NIL)
+		__rb_set_pa(view, __rb_lc(view, x), x);
+	if (__rb_rc(view, x) != view->NIL)
+		__rb_set_pa(view, __rb_rc(view, x), x);
+	__rb_set_pa(view, x, p);
+	__rb_set_color(x, __rb_RED);
+#if defined RB_ORDER_STATISTIC
+	x->size = __rb_lc(view, x)->size + __rb_rc(view, x)->size + 1;
+	for (struct __rb_node *a = p; a != view->NIL; a = __rb_pa(view, a))
+		a->size += x->size - c->size;
+#endif
+	*h = (hl > hr ? hl : hr) + __rb_insert_fixup(view, x);
+	return view->root;
+}
+
+// take the largest node out of t; the rest is returned in rest, with its black height
+static struct __rb_node * __rb_split_last(struct rb_tree *view, struct __rb_node *t, unsigned int h,
+	struct __rb_node **rest, unsigned int *hrest)
+{
+	struct __rb_node *lc = __rb_lc(view, t), *rc = __rb_rc(view, t), *m, *a;
+	unsigned int hc = h - (__rb_color_of(t) == __rb_BLACK), ha;
+	__rb_detach(view, lc);
+	__rb_detach(view, rc);
+	if (rc == view->NIL)
+	{
+		*rest = lc;
+		*hrest = hc;
+		return t;
+	}
+	m = __rb_split_last(view, rc, hc, &a, &ha);
+	*rest = __rb_join(view, lc, hc, t, a, ha, hrest);
+	return m;
+}
+
+// join without a middle element
+static struct __rb_node * __rb_join2(struct rb_tree *view, struct __rb_node *l, unsigned int hl,
+	struct __rb_node *r, unsigned int hr, unsigned int *h)
+{
+	struct __rb_node *m;
+	if (l == view->NIL)
+	{
+		*h = hr;
+		return r;
+	}
+	if (r == view->NIL)
+	{
+		*h = hl;
+		return l;
+	}
+	m = __rb_split_last(view, l, hl, &l, &hl);
+	return __rb_join(view, l, hl, m, r, hr, h);
+}
+
+// split t into the elements less than, equal to and greater than key, in O(log n)
+// plus the number of equal elements
+static void __rb_split(struct rb_tree *view, struct __rb_node *t, unsigned int h, struct __rb_data *key,
+	struct __rb_node **l, unsigned int *hl, struct __rb_node **e, unsigned int *he, struct __rb_node **r, unsigned int *hr)
+{
+	struct __rb_node *lc, *rc, *a, *b;
+	unsigned int hc, ha, hb;
+	if (t == view->NIL)
+	{
+		*l = *e = *r = view->NIL;
+		*hl = *he = *hr = 0;
+		return;
+	}
+	lc = __rb_lc(view, t);
+	rc = __rb_rc(view, t);
+	hc = h - (__rb_color_of(t) == __rb_BLACK);
+	__rb_detach(view, lc);
+	__rb_detach(view, rc);
+	if (__rb_data_less(&t->dat, key))
+	{
+		__rb_split(view, rc, hc, key, &a, &ha, e, he, r, hr);
+		*l = __rb_join(view, lc, hc, t, a, ha, hl);
+	}
+	else if (__rb_data_less(key, &t->dat))
+	{
+		__rb_split(view, lc, hc, key, l, hl, e, he, &b, &hb);
+		*r = __rb_join(view, b, hb, t, rc, hc, hr);
+	}
+	else
+	{
+		// nothing in lc is greater than key and nothing in rc less, so b and a stay empty
+		struct __rb_node *e1, *e2;
+		unsigned int h1, h2;
+		__rb_split(view, lc, hc, key, l, hl, &e1, &h1, &b, &hb);
+		__rb_split(view, rc, hc, key, &a, &ha, &e2, &h2, r, hr);
+		*e = __rb_join(view, e1, h1, t, e2, h2, he);
+	}
+}
+
+#if defined RB_PARALLEL
+// hand the nodes freed through side back to view
+static void __rb_splice_free(struct rb_tree *view, struct rb_tree *side)
+{
+	struct __rb_node *tail = side->free_nodes;
+	if (tail == view->NIL)
+		return;
+	while (__rb_lc(view, tail) != view->NIL)
+		tail = __rb_lc(view, tail);
+	__rb_set_lc(view, tail, view->free_nodes);
+	view->free_nodes = side->free_nodes;
 }
 
-void __rb_recur_destruct(struct __rb_node *ptr)
+// run second on a new thread, with a view of its own, while first runs on view
+template <class First, class Second>
+static void __rb_fork(struct rb_tree *view, First first, Second second)
 {
-	if (ptr == __rb_NIL) return;
-	if (ptr->lc != __rb_NIL) __rb_recur_destruct(ptr->lc);
-	if (ptr->rc != __rb_NIL) __rb_recur_destruct(ptr->rc);
-	free(ptr);
+	struct rb_tree side = *view;
+	side.free_nodes = view->NIL;
+	std::thread worker(second, &side);
+	first(view);
+	worker.join();
+	__rb_splice_free(view, &side);
+}
+#endif
+
+static unsigned int __rb_threads(void)
+{
+#if defined RB_PARALLEL
+	unsigned int n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+#else
+	return 1;
+#endif
+}
+
+// t1 and t2 are both subtrees of view and both are consumed; the nodes of t2
+// become the middle elements of the joins, so nothing is allocated
+static struct __rb_node * __rb_union(struct rb_tree *view, struct __rb_node *t1, unsigned int h1,
+	struct __rb_node *t2, unsigned int h2, unsigned int *h, unsigned int threads)
+{
+	struct __rb_node *l, *e, *r, *l2, *r2, *a, *b;
+	unsigned int hl, he, hr, hc, ha, hb;
+	if (t2 == view->NIL)
+	{
+		*h = h1;
+		return t1;
+	}
+	if (t1 == view->NIL)
+	{
+		*h = h2;
+		return t2;
+	}
+	l2 = __rb_lc(view, t2);
+	r2 = __rb_rc(view, t2);
+	hc = h2 - (__rb_color_of(t2) == __rb_BLACK);
+	__rb_detach(view, l2);
+	__rb_detach(view, r2);
+	__rb_split(view, t1, h1, &t2->dat, &l, &hl, &e, &he, &r, &hr);
+#if defined RB_PARALLEL
+	if (threads > 1 && h1 >= __RB_PARALLEL_MIN_HEIGHT)
+		__rb_fork(view,
+			[&](struct rb_tree *v) { a = __rb_union(v, l, hl, l2, hc, &ha, threads - threads / 2); },
+			[&](struct rb_tree *v) { b = __rb_union(v, r, hr, r2, hc, &hb, threads / 2); });
+	else
+#else
+	(void)threads;
+#endif
+	{
+		a = __rb_union(view, l, hl, l2, hc, &ha, 1);
+		b = __rb_union(view, r, hr, r2, hc, &hb, 1);
+	}
+	// the elements of t1 equal to t2's root go right after it
+	b = __rb_join2(view, e, he, b, hb, &hb);
+	return __rb_join(view, a, ha, t2, b, hb, h);
+}
+
+// keep the elements of t1 (a subtree of view) equal to some element of t2 (a subtree of other)
+static struct __rb_node * __rb_intersection(struct rb_tree *view, struct __rb_node *t1, unsigned int h1,
+	struct rb_tree *other, struct __rb_node *t2, unsigned int *h, unsigned int threads)
+{
+	struct __rb_node *l, *e, *r, *a, *b;
+	unsigned int hl, he, hr, ha, hb;
+	if (t1 == view->NIL || t2 == other->NIL)
+	{
+		__rb_free_subtree(view, t1);
+		*h = 0;
+		return view->NIL;
+	}
+	__rb_split(view, t1, h1, &t2->dat, &l, &hl, &e, &he, &r, &hr);
+#if defined RB_PARALLEL
+	if (threads > 1 && h1 >= __RB_PARALLEL_MIN_HEIGHT)
+		__rb_fork(view,
+			[&](struct rb_tree *v) { a = __rb_intersection(v, l, hl, other, __rb_lc(other, t2), &ha, threads - threads / 2); },
+			[&](struct rb_tree *v) { b = __rb_intersection(v, r, hr, other, __rb_rc(other, t2), &hb, threads / 2); });
+	else
+#else
+	(void)threads;
+#endif
+	{
+		a = __rb_intersection(view, l, hl, other, __rb_lc(other, t2), &ha, 1);
+		b = __rb_intersection(view, r, hr, other, __rb_rc(other, t2), &hb, 1);
+	}
+	b = __rb_join2(view, e, he, b, hb, &hb);
+	return __rb_join2(view, a, ha, b, hb, h);
+}
+
+// drop the elements of t1 (a subtree of view) equal to some element of t2 (a subtree of other)
+static struct __rb_node * __rb_difference(struct rb_tree *view, struct __rb_node *t1, unsigned int h1,
+	struct rb_tree *other, struct __rb_node *t2, unsigned int *h, unsigned int threads)
+{
+	struct __rb_node *l, *e, *r, *a, *b;
+	unsigned int hl, he, hr, ha, hb;
+	if (t1 == view->NIL || t2 == other->NIL)
+	{
+		*h = h1;
+		return t1;
+	}
+	__rb_split(view, t1, h1, &t2->dat, &l, &hl, &e, &he, &r, &hr);
+	__rb_free_subtree(view, e);
+#if defined RB_PARALLEL
+	if (threads > 1 && h1 >= __RB_PARALLEL_MIN_HEIGHT)
+		__rb_fork(view,
+			[&](struct rb_tree *v) { a = __rb_difference(v, l, hl, other, __rb_lc(other, t2), &ha, threads - threads / 2); },
+			[&](struct rb_tree *v) { b = __rb_difference(v, r, hr, other, __rb_rc(other, t2), &hb, threads / 2); });
+	else
+#else
+	(void)threads;
+#endif
+	{
+		a = __rb_difference(view, l, hl, other, __rb_lc(other, t2), &ha, 1);
+		b = __rb_difference(view, r, hr, other, __rb_rc(other, t2), &hb, 1);
+	}
+	return __rb_join2(view, a, ha, b, hb, h);
+}
+
+// qsort order from __rb_data_less
+static int __rb_data_compare(const void *x, const void *y)
+{
+	struct __rb_data *a = (struct __rb_data *)x, *b = (struct __rb_data *)y;
+	return __rb_data_less(a, b) ? -1 : __rb_data_less(b, a);
+}
+
+// the nodes need no cleanup of their own, so whole slabs go back at once
+static void __rb_free_slabs(struct rb_tree *tree)
+{
+	for (unsigned int i = 0; i < tree->slab_count; ++i)
+		free(tree->slabs[i]);
+	free(tree->slabs);
+	tree->slabs = NULL;
+	tree->slab_count = tree->slab_capacity = 0;
+	tree->slab_next = tree->slab_end = NULL;
+	tree->free_nodes = NULL;
 }
 
 /**********
@@ -318,65 +914,551 @@ void __rb_recur_destruct(struct __rb_node *ptr)
 *  Public Interface Block
 ***********/
 
-void rb_init_tree()
+void rb_init_tree(struct rb_tree *tree)
+{
+	tree->slabs = NULL;
+	tree->slab_count = tree->slab_capacity = 0;
+	tree->slab_next = tree->slab_end = NULL;
+	tree->NIL = tree->free_nodes = NULL;
+	tree->free_nodes = tree->NIL = __rb_new_node(tree);
+	tree->root = tree->NIL;
+	__rb_set_lc(tree, tree->NIL, tree->NIL);
+	__rb_set_rc(tree, tree->NIL, tree->NIL);
+	__rb_set_pa(tree, tree->NIL, tree->NIL);
+	__rb_set_color(tree->NIL, __rb_BLACK);
+#if defined RB_ORDER_STATISTIC
+	tree->NIL->size = 0;
+#endif
+}
+
+void rb_destruct_tree(struct rb_tree *tree)
 {
-	__rb_NIL = (struct __rb_node*)malloc(sizeof(struct __rb_node));
-	__rb_root = __rb_NIL;
-	__rb_NIL->color = __rb_BLACK;
+	__rb_free_slabs(tree);
+	tree->root = NULL;
+	tree->NIL = NULL;
 }
 
-void rb_destruct_tree()
+// replace the contents of an initialized tree with array[0, n), which must be sorted;
+// O(n), with the nodes laid out in order in fresh slabs
+void rb_build_from_sorted(struct rb_tree *tree, struct __rb_data *array, unsigned int n)
 {
-	__rb_recur_destruct(__rb_root);
-	__rb_root = NULL;
-	free(__rb_NIL);
-	__rb_NIL = NULL;
+	// levels 0 .. red_depth - 1 are full, only the last level is partly filled
+	unsigned int red_depth = 0;
+	while ((2ull << red_depth) - 1 <= n)
+		++red_depth;
+	__rb_free_slabs(tree);
+	rb_init_tree(tree);
+	tree->root = __rb_build(tree, array, 0, n, tree->NIL, 0, red_depth);
 }
 
-void rb_insert_data(struct __rb_data ins_data)
+void rb_insert_data(struct rb_tree *tree, struct __rb_data ins_data)
 {
 	struct __rb_node *z;
-	z = (struct __rb_node *)malloc(sizeof(struct __rb_node));
+	z = __rb_new_node(tree);
 	z->dat = ins_data;
-	__rb_insert(z);
+	__rb_insert(tree, z);
 }
 
-struct __rb_node * rb_find(struct __rb_data find_data)
+// return the node holding find_data, or tree->NIL when there is none
+struct __rb_node * rb_find(struct rb_tree *tree, struct __rb_data find_data)
 {
-	struct __rb_node * pos = __rb_root;
-	while (pos)
+	struct __rb_node * pos = tree->root;
+	while (pos != tree->NIL)
 	{
 		if (__rb_data_less(&find_data, &pos->dat))
-			pos = pos->lc;
+			pos = __rb_lc(tree, pos);
 		else if (__rb_data_less(&pos->dat, &find_data))
-			pos = pos->rc;
+			pos = __rb_rc(tree, pos);
 		else
 			break;
 	}
 	return pos;
 }
 
+// lookups kept in flight at once by rb_find_many, enough to cover a memory
+// access with the work of the others
+#define __RB_FIND_GROUP 16
+
+#if defined __GNUC__
+#define __rb_prefetch(x) __builtin_prefetch(x)
+#else
+#define __rb_prefetch(x) ((void)(x))
+#endif
+
+// out[i] = rb_find(tree, keys[i]) for every i < n; the descents are interleaved,
+// each one advancing a level and prefetching its next node while the others run
+void rb_find_many(struct rb_tree *tree, struct __rb_data *keys, unsigned int n, struct __rb_node **out)
+{
+	struct __rb_node *pos[__RB_FIND_GROUP], *x;
+	struct __rb_data *key;
+	unsigned int which[__RB_FIND_GROUP], active, next, i;
+	for (active = 0; active < __RB_FIND_GROUP && active < n; ++active)
+	{
+		which[active] = active;
+		pos[active] = tree->root;
+	}
+	next = active;
+	while (active > 0)
+	{
+		for (i = 0; i < active; )
+		{
+			x = pos[i];
+			key = &keys[which[i]];
+			if (x != tree->NIL && __rb_data_less(key, &x->dat))
+				x = __rb_lc(tree, x);
+			else if (x != tree->NIL && __rb_data_less(&x->dat, key))
+				x = __rb_rc(tree, x);
+			else
+			{
+				out[which[i]] = x;
+				if (next < n)
+				{
+					// start the next key from the root in this slot
+					which[i] = next++;
+					pos[i++] = tree->root;
+				}
+				else
+				{
+					--active;
+					which[i] = which[active];
+					pos[i] = pos[active];
+				}
+				continue;
+			}
+			__rb_prefetch(x);
+			pos[i++] = x;
+		}
+	}
+}
+
 // return 1 on successful deletion, otherwise 0
-int rb_delete_data(struct __rb_data del_data)
+int rb_delete_data(struct rb_tree *tree, struct __rb_data del_data)
 {
 	struct __rb_node *ptr;
-	ptr = rb_find(del_data);
-	if (ptr != __rb_NIL)
+	ptr = rb_find(tree, del_data);
+	if (ptr != tree->NIL)
 	{
-		__rb_delete(ptr);
+		__rb_delete(tree, ptr);
 		return 1;
 	}
 	return 0;
 }
 
-void rb_middle_traverse(struct __rb_node *ptr)
+// insert every element of array[0, n), as rb_insert_data would; the array is sorted
+// in place first, so consecutive descents share their upper levels in the cache
+void rb_insert_batch(struct rb_tree *tree, struct __rb_data *array, unsigned int n)
+{
+	struct __rb_node *z;
+	qsort(array, n, sizeof(struct __rb_data), __rb_data_compare);
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		z = __rb_new_node(tree);
+		z->dat = array[i];
+		__rb_insert(tree, z);
+	}
+}
+
+// delete one element equal to each of array[0, n), as rb_delete_data would,
+// and return how many were found; the array is sorted in place first
+unsigned int rb_delete_batch(struct rb_tree *tree, struct __rb_data *array, unsigned int n)
+{
+	struct __rb_node *ptr;
+	unsigned int deleted = 0;
+	qsort(array, n, sizeof(struct __rb_data), __rb_data_compare);
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		ptr = rb_find(tree, array[i]);
+		if (ptr != tree->NIL)
+		{
+			__rb_delete(tree, ptr);
+			++deleted;
+		}
+	}
+	return deleted;
+}
+
+#if defined RB_ORDER_STATISTIC
+unsigned int rb_size(struct rb_tree *tree)
+{
+	return tree->root->size;
+}
+
+// return the k-th smallest node, counting from 1, or tree->NIL when k is out of range
+struct __rb_node * rb_select(struct rb_tree *tree, unsigned int k)
+{
+	struct __rb_node *pos = tree->root;
+	while (pos != tree->NIL)
+	{
+		unsigned int left = __rb_lc(tree, pos)->size;
+		if (k <= left)
+			pos = __rb_lc(tree, pos);
+		else if (k == left + 1)
+			break;
+		else
+		{
+			k -= left + 1;
+			pos = __rb_rc(tree, pos);
+		}
+	}
+	return pos;
+}
+
+// return how many elements are smaller than rank_data,
+// so its first copy (if any) is rb_select(tree, rb_rank(tree, rank_data) + 1)
+unsigned int rb_rank(struct rb_tree *tree, struct __rb_data rank_data)
+{
+	struct __rb_node *pos = tree->root;
+	unsigned int smaller = 0;
+	while (pos != tree->NIL)
+	{
+		if (__rb_data_less(&pos->dat, &rank_data))
+		{
+			smaller += __rb_lc(tree, pos)->size + 1;
+			pos = __rb_rc(tree, pos);
+		}
+		else
+			pos = __rb_lc(tree, pos);
+	}
+	return smaller;
+}
+#endif
+
+/**********
+*  Iteration: nodes come in order, tree->NIL marks the end in both directions.
+*      for (p = rb_first(&index); p != index.NIL; p = rb_next(&index, p)) ...
+*      for (p = rb_last(&index); p != index.NIL; p = rb_prev(&index, p)) ...
+*  Each step follows the pa links, O(1) amortized over a whole pass.
+***********/
+
+struct __rb_node * rb_first(struct rb_tree *tree)
+{
+	if (tree->root == tree->NIL)
+		return tree->NIL;
+	return __rb_tree_minimum(tree, tree->root);
+}
+
+struct __rb_node * rb_last(struct rb_tree *tree)
+{
+	if (tree->root == tree->NIL)
+		return tree->NIL;
+	return __rb_tree_maximum(tree, tree->root);
+}
+
+struct __rb_node * rb_next(struct rb_tree *tree, struct __rb_node *x)
+{
+	struct __rb_node *y;
+	if (__rb_rc(tree, x) != tree->NIL)
+		return __rb_tree_minimum(tree, __rb_rc(tree, x));
+	y = __rb_pa(tree, x);
+	while (y != tree->NIL && x == __rb_rc(tree, y))
+	{
+		x = y;
+		y = __rb_pa(tree, y);
+	}
+	return y;
+}
+
+struct __rb_node * rb_prev(struct rb_tree *tree, struct __rb_node *x)
+{
+	struct __rb_node *y;
+	if (__rb_lc(tree, x) != tree->NIL)
+		return __rb_tree_maximum(tree, __rb_lc(tree, x));
+	y = __rb_pa(tree, x);
+	while (y != tree->NIL && x == __rb_lc(tree, y))
+	{
+		x = y;
+		y = __rb_pa(tree, y);
+	}
+	return y;
+}
+
+// return the first node not less than find_data, or tree->NIL
+struct __rb_node * rb_lower_bound(struct rb_tree *tree, struct __rb_data find_data)
+{
+	struct __rb_node *pos = tree->root, *found = tree->NIL;
+	while (pos != tree->NIL)
+	{
+		if (__rb_data_less(&pos->dat, &find_data))
+			pos = __rb_rc(tree, pos);
+		else
+		{
+			found = pos;
+			pos = __rb_lc(tree, pos);
+		}
+	}
+	return found;
+}
+
+// return the first node greater than find_data, or tree->NIL
+struct __rb_node * rb_upper_bound(struct rb_tree *tree, struct __rb_data find_data)
+{
+	struct __rb_node *pos = tree->root, *found = tree->NIL;
+	while (pos != tree->NIL)
+	{
+		if (__rb_data_less(&find_data, &pos->dat))
+		{
+			found = pos;
+			pos = __rb_lc(tree, pos);
+		}
+		else
+			pos = __rb_rc(tree, pos);
+	}
+	return found;
+}
+
+// call visit on every element x with lo <= x < hi, in order, until it returns nonzero;
+// return the number of elements visited
+unsigned int rb_range(struct rb_tree *tree, struct __rb_data lo, struct __rb_data hi,
+	int (*visit)(struct __rb_data *x, void *arg), void *arg)
+{
+	unsigned int count = 0;
+	struct __rb_node *pos;
+	for (pos = rb_lower_bound(tree, lo); pos != tree->NIL && __rb_data_less(&pos->dat, &hi); pos = rb_next(tree, pos))
+	{
+		++count;
+		if (visit(&pos->dat, arg))
+			break;
+	}
+	return count;
+}
+
+/**********
+*  Split, Join and Set Operations
+*  Both trees must be initialized. Nodes cannot be shared between trees, so
+*  rb_split and rb_join copy the side with the smaller black height over and
+*  swap the handles when that keeps the copy small; everything else is relinked
+*  in place. The set operations treat other as read-only, except that rb_union
+*  first copies it into tree; their recursion runs on several threads with
+*  RB_PARALLEL.
+*      rb_union(&index, &deltas);
+***********/
+
+// move every element not less than split_data from tree to right, replacing what right held
+void rb_split(struct rb_tree *tree, struct __rb_data split_data, struct rb_tree *right)
+{
+	struct __rb_node *l, *e, *r;
+	unsigned int hl, he, hr;
+	struct rb_tree swap;
+	__rb_split(tree, tree->root, __rb_black_height(tree, tree->root), &split_data, &l, &hl, &e, &he, &r, &hr);
+	r = __rb_join2(tree, e, he, r, hr, &hr);
+	__rb_free_slabs(right);
+	rb_init_tree(right);
+	if (hr <= hl)
+	{
+		__rb_set_root(right, __rb_copy(right, tree, r, right->NIL));
+		__rb_free_subtree(tree, r);
+		__rb_set_root(tree, l);
+	}
+	else
+	{
+		__rb_set_root(right, __rb_copy(right, tree, l, right->NIL));
+		__rb_free_subtree(tree, l);
+		__rb_set_root(tree, r);
+		swap = *tree;
+		*tree = *right;
+		*right = swap;
+	}
+}
+
+// append every element of right to tree, leaving right empty;
+// no element of tree may be greater than an element of right
+void rb_join(struct rb_tree *tree, struct rb_tree *right)
+{
+	unsigned int hl = __rb_black_height(tree, tree->root), hr = __rb_black_height(right, right->root), h;
+	struct rb_tree swap;
+	if (hl >= hr)
+		__rb_set_root(tree, __rb_join2(tree, tree->root, hl, __rb_copy(tree, right, right->root, tree->NIL), hr, &h));
+	else
+	{
+		__rb_set_root(right, __rb_join2(right, __rb_copy(right, tree, tree->root, right->NIL), hl, right->root, hr, &h));
+		swap = *tree;
+		*tree = *right;
+		*right = swap;
+	}
+	__rb_free_slabs(right);
+	rb_init_tree(right);
+}
+
+// add every element of other to tree, duplicates included, as inserting them one by one would;
+// O(m log(n / m + 1)) for m = the size of other, after copying it
+void rb_union(struct rb_tree *tree, struct rb_tree *other)
+{
+	unsigned int h1 = __rb_black_height(tree, tree->root), h2 = __rb_black_height(other, other->root), h;
+	struct __rb_node *t2 = __rb_copy(tree, other, other->root, tree->NIL);
+	__rb_set_root(tree, __rb_union(tree, tree->root, h1, t2, h2, &h, __rb_threads()));
+}
+
+// keep only the elements of tree equal to some element of other
+void rb_intersection(struct rb_tree *tree, struct rb_tree *other)
+{
+	unsigned int h;
+	if (other == tree)
+		return;
+	__rb_set_root(tree, __rb_intersection(tree, tree->root, __rb_black_height(tree, tree->root),
+		other, other->root, &h, __rb_threads()));
+}
+
+// remove every element of tree equal to some element of other
+void rb_difference(struct rb_tree *tree, struct rb_tree *other)
+{
+	unsigned int h;
+	if (other == tree)
+	{
+		__rb_free_slabs(tree);
+		rb_init_tree(tree);
+		return;
+	}
+	__rb_set_root(tree, __rb_difference(tree, tree->root, __rb_black_height(tree, tree->root),
+		other, other->root, &h, __rb_threads()));
+}
+
+/**********
+*  Frozen Layout
+*  A read-only snapshot of a tree as a sorted array in Eytzinger (BFS) order:
+*  the root is keys[1] and the children of keys[k] are keys[2k] and keys[2k + 1].
+*  Searches need no pointers and no unpredictable branches. The array starts on a
+*  cache line, so the descendants of keys[k] a few levels down (four for 4-byte data)
+*  fill the line at keys[k * __RB_FROZEN_LINE], which is prefetched in advance.
+*  Positions are returned as indices into keys, 0 meaning none.
+*      struct rb_frozen snapshot;
+*      rb_init_frozen(&snapshot);
+*      rb_freeze(&index, &snapshot);      // again after updates, to refresh
+*      k = rb_frozen_find(&snapshot, data);
+*      rb_destruct_frozen(&snapshot);
+***********/
+
+struct rb_frozen
+{
+	struct __rb_data *keys;
+	unsigned int n, capacity;
+};
+
+// elements per cache line, the prefetch looks that many descendants ahead
+#define __RB_FROZEN_LINE (sizeof(struct __rb_data) < 64 ? 64 / sizeof(struct __rb_data) : 1)
+
+// the address of keys[k * __RB_FROZEN_LINE], computed as an integer because it is
+// often past the end of the array, where a prefetch is harmless but a pointer is not
+inline static const void * __rb_frozen_ahead(struct rb_frozen *frozen, unsigned int k)
+{
+	return (const void *)((size_t)frozen->keys + (size_t)k * __RB_FROZEN_LINE * sizeof(struct __rb_data));
+}
+
+void rb_init_frozen(struct rb_frozen *frozen)
+{
+	frozen->keys = NULL;
+	frozen->n = frozen->capacity = 0;
+}
+
+void rb_destruct_frozen(struct rb_frozen *frozen)
+{
+	free(frozen->keys);
+	rb_init_frozen(frozen);
+}
+
+// fills the implicit subtree at k in order from x on, returns the node after the last one used
+static struct __rb_node * __rb_freeze(struct rb_tree *tree, struct rb_frozen *frozen, unsigned int k, struct __rb_node *x)
+{
+	if (k > frozen->n)
+		return x;
+	x = __rb_freeze(tree, frozen, 2 * k, x);
+	frozen->keys[k] = x->dat;
+	return __rb_freeze(tree, frozen, 2 * k + 1, rb_next(tree, x));
+}
+
+// copy the contents of tree into frozen, replacing what it held; O(n)
+void rb_freeze(struct rb_tree *tree, struct rb_frozen *frozen)
+{
+	unsigned int n = 0;
+	struct __rb_node *pos;
+	for (pos = rb_first(tree); pos != tree->NIL; pos = rb_next(tree, pos))
+		++n;
+	if (n + 1 > frozen->capacity)
+	{
+		// cache-line aligned like the slabs, and the old contents are not needed
+		size_t bytes = (sizeof(struct __rb_data) * (n + 1) + 63) & ~(size_t)63;
+		free(frozen->keys);
+		frozen->keys = (struct __rb_data *)aligned_alloc(64, bytes);
+		frozen->capacity = (unsigned int)(bytes / sizeof(struct __rb_data));
+	}
+	frozen->n = n;
+	__rb_freeze(tree, frozen, 1, rb_first(tree));
+}
+
+// the first position not less than find_data, or 0
+unsigned int rb_frozen_lower_bound(struct rb_frozen *frozen, struct __rb_data find_data)
+{
+	unsigned int k = 1;
+	while (k <= frozen->n)
+	{
+		__rb_prefetch(__rb_frozen_ahead(frozen, k));
+		k = 2 * k + __rb_data_less(&frozen->keys[k], &find_data);
+	}
+	// undo the right turns after the last left one, that left turn was the answer
+	while (k & 1)
+		k >>= 1;
+	return k >> 1;
+}
+
+// the first position greater than find_data, or 0
+unsigned int rb_frozen_upper_bound(struct rb_frozen *frozen, struct __rb_data find_data)
+{
+	unsigned int k = 1;
+	while (k <= frozen->n)
+	{
+		__rb_prefetch(__rb_frozen_ahead(frozen, k));
+		k = 2 * k + !__rb_data_less(&find_data, &frozen->keys[k]);
+	}
+	while (k & 1)
+		k >>= 1;
+	return k >> 1;
+}
+
+// the position of an element equal to find_data, or 0
+unsigned int rb_frozen_find(struct rb_frozen *frozen, struct __rb_data find_data)
+{
+	unsigned int k = rb_frozen_lower_bound(frozen, find_data);
+	if (k != 0 && __rb_data_less(&find_data, &frozen->keys[k]))
+		return 0;
+	return k;
+}
+
+// the position after k in sorted order, or 0
+unsigned int rb_frozen_next(struct rb_frozen *frozen, unsigned int k)
+{
+	if (2 * k + 1 <= frozen->n)
+	{
+		for (k = 2 * k + 1; 2 * k <= frozen->n; k *= 2)
+			;
+		return k;
+	}
+	while (k & 1)
+		k >>= 1;
+	return k >> 1;
+}
+
+// call visit on every element x with lo <= x < hi, in order, until it returns nonzero;
+// return the number of elements visited
+unsigned int rb_frozen_range(struct rb_frozen *frozen, struct __rb_data lo, struct __rb_data hi,
+	int (*visit)(struct __rb_data *x, void *arg), void *arg)
+{
+	unsigned int count = 0, k;
+	for (k = rb_frozen_lower_bound(frozen, lo); k != 0 && __rb_data_less(&frozen->keys[k], &hi); k = rb_frozen_next(frozen, k))
+	{
+		++count;
+		if (visit(&frozen->keys[k], arg))
+			break;
+	}
+	return count;
+}
+
+void rb_middle_traverse(struct rb_tree *tree, struct __rb_node *ptr)
 {
-	if (ptr == __rb_NIL) return;
-	if (ptr->lc != __rb_NIL)
-		rb_middle_traverse(ptr->lc);
+	if (ptr == tree->NIL) return;
+	if (__rb_lc(tree, ptr) != tree->NIL)
+		rb_middle_traverse(tree, __rb_lc(tree, ptr));
 	printf("%d ", ptr->dat.val);
-	if (ptr->rc != __rb_NIL)
-		rb_middle_traverse(ptr->rc);
+	if (__rb_rc(tree, ptr) != tree->NIL)
+		rb_middle_traverse(tree, __rb_rc(tree, ptr));
 }
 
 /**********